@@ -6,35 +6,26 @@
 #include <cctype>
 #include <fstream>
 #include <sstream> 
+#include "../common/Workload.h"
 
 using namespace std;
 
-// randomly generate a string (given a vocabulary and the length of the generated string)
-string randomString(const string& chars, int length) {
-    string result;
-    for (int i = 0; i < length; ++i) {
-        result += chars[rand() % chars.size()];
-    }
-    return result;
-}
-
 // randomly generate names (all lower cases)
-string randomName() {
-    const string chars = "abcdefghijklmnopqrstuvwxyz";
-    string name = randomString(chars, rand() % 6 + 3); // length == [3, 8]
-    return name;
+string randomName(WorkloadRng& rng) {
+    int length = (int)rng.between(3, 8);
+    return randomString(rng, length, LOWERCASE_LETTERS, sizeof(LOWERCASE_LETTERS) - 1);
 }
 
 // randomly generate emails
-string randomEmail(const string& first, const string& last) {
-    const vector<string> domains = { "gmail.com", "yahoo.com", "outlook.com", "example.com" };
-    return first + "." + last + "@" + domains[rand() % domains.size()];
+string randomEmail(WorkloadRng& rng, const string& first, const string& last) {
+    static const vector<string> domains = { "gmail.com", "yahoo.com", "outlook.com", "example.com" };
+    return first + "." + last + "@" + domains[rng.below(domains.size())];
 }
 
 // randomly generate categories
-string randomCategory() {
-    const vector<string> categories = { "Technology", "Sports", "Music", "Food", "Travel", "Education" };
-    return categories[rand() % categories.size()];
+string randomCategory(WorkloadRng& rng) {
+    static const vector<string> categories = { "Technology", "Sports", "Music", "Food", "Travel", "Education" };
+    return categories[rng.below(categories.size())];
 }
 
 struct User {
@@ -102,22 +93,25 @@ vector<User> readCSV(const string& fileName) {
     return users;
 }
 
-vector<User> generateUsers(int n) {
-    srand(time(0)); // set a random seed
+// the same seed gives the same users; each user has its own generator, so they are built in parallel
+vector<User> generateUsers(int n, uint64_t seed = 2024) {
     vector<User> users = readCSV("./existingData.csv");
     int numExist = users.size();
-    for (int i = 0; i < n - numExist; ++i) {
+    if (n <= numExist)
+        return users;
+    vector<User> generated = generateRecords<User>(n - numExist, seed, [](WorkloadRng& rng, size_t) {
         User user;
-        user.firstName = randomName();
-        user.lastName = randomName();
-        user.userName = randomName() + "_" + user.firstName + user.lastName + to_string(rand() % 100);
-        user.email = randomEmail(user.firstName, user.lastName);
-        user.numPosts = rand() % 1000; // # of twitts: 0 - 999
-        user.mostViewedCategory = randomCategory();
+        user.firstName = randomName(rng);
+        user.lastName = randomName(rng);
+        user.userName = randomName(rng) + "_" + user.firstName + user.lastName + to_string(rng.below(100));
+        user.email = randomEmail(rng, user.firstName, user.lastName);
+        user.numPosts = (int)rng.below(1000); // # of twitts: 0 - 999
+        user.mostViewedCategory = randomCategory(rng);
         user.firstName[0] = toupper(user.firstName[0]);
         user.lastName[0] = toupper(user.lastName[0]);
-        users.push_back(user);
-    }
+        return user;
+    });
+    users.insert(users.end(), generated.begin(), generated.end());
 
     return users;
 }
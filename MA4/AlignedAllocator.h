@@ -0,0 +1,60 @@
+//***************************************************************************//
+//**
+//**  Allocator for cache-line aligned containers
+//**
+//***************************************************************************//
+
+#ifndef __ALIGNED_ALLOCATOR_H
+#define __ALIGNED_ALLOCATOR_H
+#include <cstddef>
+#include <cstdlib>
+#include <new> // std::bad_alloc
+
+const std::size_t CACHE_LINE_BYTES = 64;
+
+/**
+ *  Minimal C++11 allocator whose blocks start on an Alignment-byte boundary, so that
+ *   std::vector<T, AlignedAllocator<T>> element 0 begins a cache line.
+ *  With Offset > 0, element 0 is placed Offset elements past the boundary instead (the skipped
+ *   slots are never constructed), which is how Heap lines up its sibling groups.
+ */
+template <typename T, std::size_t Alignment = CACHE_LINE_BYTES, std::size_t Offset = 0>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment, Offset> other;
+	};
+
+	AlignedAllocator() {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment, Offset> &) {}
+
+	T *allocate(std::size_t n)
+	{
+		void *p = nullptr;
+		if (posix_memalign(&p, Alignment < alignof(T) ? alignof(T) : Alignment, (n + Offset) * sizeof(T)) != 0)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T *>(p) + Offset;
+	}
+
+	void deallocate(T *p, std::size_t)
+	{
+		free(p - Offset);
+	}
+};
+
+template <typename T, typename U, std::size_t Alignment, std::size_t Offset>
+bool operator==(const AlignedAllocator<T, Alignment, Offset> &, const AlignedAllocator<U, Alignment, Offset> &) { return true; }
+
+template <typename T, typename U, std::size_t Alignment, std::size_t Offset>
+bool operator!=(const AlignedAllocator<T, Alignment, Offset> &, const AlignedAllocator<U, Alignment, Offset> &) { return false; }
+
+#endif
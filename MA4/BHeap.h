@@ -0,0 +1,279 @@
+//***************************************************************************//
+//**
+//**  B-heap: binary heap laid out in page-sized blocks
+//**
+//***************************************************************************//
+
+#ifndef __B_HEAP_H
+#define __B_HEAP_H
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>  // std::out_of_range
+#include <functional> // std::less
+#include <utility>	  // std::move, std::forward
+#include "AlignedAllocator.h"
+
+const std::size_t PAGE_BYTES = 4096;
+
+// largest power of two <= x, and log2 of a power of two, for BHeap's compile-time page geometry
+constexpr std::size_t pageFloorPow2(std::size_t x, std::size_t p = 1)
+{
+	return (p * 2 > x) ? p : pageFloorPow2(x, p * 2);
+}
+
+constexpr int pageLog2(std::size_t x)
+{
+	return (x <= 1) ? 0 : 1 + pageLog2(x / 2);
+}
+
+/**
+ *  Declaring BHeap class
+ *
+ *  A binary heap with Heap's ordering and interface, stored in Kamp's B-heap layout ("You're
+ *   Doing It Wrong", 2010) for heaps much larger than the TLB reach or than RAM. In Heap's
+ *   array layout, node i's children are at 2i + 1 and 2i + 2, so below the top few levels every
+ *   level of a percolateDown reads a different page. Here the tree is cut into subtrees that each
+ *   fill one page:
+ *   - page 0 holds the top levels, the root in slot 1 and node j's children in slots 2j, 2j + 1;
+ *   - every other page holds a pair of sibling subtrees, rooted in slots 2 and 3, numbered inside
+ *     the page the same way, so a node and the sibling it is compared with never share a page
+ *     boundary;
+ *   - the two children of the node in leaf slot PAGE_SLOTS / 2 + l of page p are the roots of page
+ *     p * PAGE_SLOTS / 2 + 1 + l.
+ *  So push and pop touch one page per log2(PAGE_SLOTS) - 1 levels, O(log n / log B) pages instead
+ *   of O(log n - log B).
+ *  The tree grows page by page rather than level by level: the next node goes into the next free
+ *   slot of the last page, and a new page is started once it is full. Every page's parent page is
+ *   full by then, so each new node hangs below an existing one and the last node is always a leaf;
+ *   the shape is no longer a complete binary tree, but it stays within one page level of one, and
+ *   no page is left mostly empty.
+ *  PAGE_SLOTS is the largest power of two whose slots fit in PageBytes; if sizeof(T) is a power of
+ *   two a page is exactly one aligned PageBytes block. Slots 0 and 1 of each page except slot 1 of
+ *   page 0 stay unused, 2 / PAGE_SLOTS of the storage. T must be default constructible as well as
+ *   movable, since whole pages are allocated at once.
+ */
+template <typename T, typename Compare = std::less<T>, std::size_t PageBytes = PAGE_BYTES>
+class BHeap
+{
+public:
+	typedef T value_type;
+
+private:
+	static const std::size_t PAGE_SLOTS = pageFloorPow2(PageBytes / sizeof(T));
+	static const std::size_t HALF = PAGE_SLOTS / 2;		 // first leaf slot of a page, and child pages per page
+	static const std::size_t ROOT_NODES = PAGE_SLOTS - 1; // nodes in page 0, slots 1 ..
+	static const std::size_t PAGE_NODES = PAGE_SLOTS - 2; // nodes in every other page, slots 2 ..
+	static_assert(PageBytes / sizeof(T) >= 4, "BHeap page must hold at least four items");
+
+	struct Position
+	{
+		std::size_t page;
+		std::size_t slot;
+	};
+
+	std::vector<T, AlignedAllocator<T, PageBytes>> _items; // whole pages, page 0 first
+	std::size_t _size;
+	Compare _compare;
+
+	T &at(const Position &pos)
+	{
+		return _items[pos.page * PAGE_SLOTS + pos.slot];
+	}
+
+	// storage of the node added as number i (0-based): pages fill in order, each in slot order
+	static Position positionOf(std::size_t i)
+	{
+		if (i < ROOT_NODES)
+		{
+			Position pos = {0, i + 1};
+			return pos;
+		}
+		Position pos = {1 + (i - ROOT_NODES) / PAGE_NODES, 2 + (i - ROOT_NODES) % PAGE_NODES};
+		return pos;
+	}
+
+	static Position parentOf(const Position &pos)
+	{
+		if (pos.slot >= 4 || pos.page == 0)
+		{
+			Position parent = {pos.page, pos.slot / 2};
+			return parent;
+		}
+		Position parent = {(pos.page - 1) / HALF, HALF + (pos.page - 1) % HALF};
+		return parent;
+	}
+
+	// the left child; the right child is always the next slot of the same page
+	static Position leftChildOf(const Position &pos)
+	{
+		if (pos.slot < HALF)
+		{
+			Position child = {pos.page, pos.slot * 2};
+			return child;
+		}
+		Position child = {pos.page * HALF + 1 + (pos.slot - HALF), 2};
+		return child;
+	}
+
+	void percolateDown(Position hole)
+	{
+		T tmp = std::move(at(hole));
+		Position last = positionOf(_size - 1); // nodes are the positions up to last, in fill order
+
+		while (true)
+		{
+			Position child = leftChildOf(hole);
+			if (child.page > last.page || (child.page == last.page && child.slot > last.slot))
+			{
+				break;
+			}
+			if ((child.page < last.page || child.slot < last.slot) && _compare(_items[child.page * PAGE_SLOTS + child.slot + 1], at(child)))
+			{
+				child.slot++;
+			}
+			if (_compare(at(child), tmp))
+			{
+				at(hole) = std::move(at(child));
+				hole = child;
+			}
+			else
+			{
+				break;
+			}
+		}
+		at(hole) = std::move(tmp);
+	}
+
+	void percolateUp(Position hole)
+	{
+		T tmp = std::move(at(hole));
+
+		while (hole.page != 0 || hole.slot != 1)
+		{
+			Position parent = parentOf(hole);
+			if (!_compare(tmp, at(parent)))
+			{
+				break;
+			}
+			at(hole) = std::move(at(parent));
+			hole = parent;
+		}
+		at(hole) = std::move(tmp);
+	}
+
+	// storage for the next node, allocating its page if it is the first node there
+	Position append()
+	{
+		Position pos = positionOf(_size);
+		if (pos.page * PAGE_SLOTS >= _items.size())
+		{
+			_items.resize((pos.page + 1) * PAGE_SLOTS);
+		}
+		_size++;
+		return pos;
+	}
+
+public:
+	explicit BHeap(const Compare &compare = Compare()) : _size(0), _compare(compare)
+	{
+	}
+
+	void push(const T &item)
+	{
+		Position pos = append();
+		at(pos) = item;
+		percolateUp(pos);
+	}
+
+	void push(T &&item)
+	{
+		Position pos = append();
+		at(pos) = std::move(item);
+		percolateUp(pos);
+	}
+
+	template <typename... Args>
+	void emplace(Args &&...args)
+	{
+		push(T(std::forward<Args>(args)...));
+	}
+
+	const T &top() const
+	{
+		if (empty())
+		{
+			throw std::out_of_range("top() - No elements in heap");
+		}
+		return _items[1];
+	}
+
+	/**
+	 *  Removes the top (by default minimum) value from heap and moves it out
+	 */
+	T pop()
+	{
+		if (empty())
+		{
+			throw std::out_of_range("pop() - No elements in heap");
+		}
+		Position root = {0, 1};
+		T topItem = std::move(at(root));
+		Position last = positionOf(_size - 1);
+		if (_size > 1)
+		{
+			at(root) = std::move(at(last)); // Move last item to root
+		}
+		_size--;
+		if (_size > 1)
+		{
+			percolateDown(root);
+		}
+		return topItem;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	long unsigned int size() const
+	{
+		return _size;
+	}
+
+	/**
+	 *  Allocates the pages for n items, so pushes up to n do not reallocate
+	 */
+	void reserve(long unsigned int n)
+	{
+		if (n > 0)
+		{
+			_items.reserve((positionOf(n - 1).page + 1) * PAGE_SLOTS);
+		}
+	}
+
+	/**
+	 *  Bytes of page storage held, used or not
+	 */
+	long unsigned int memoryBytes() const
+	{
+		return _items.capacity() * sizeof(T);
+	}
+
+	/**
+	 *  Return heap data in storage order; needs operator<< for T
+	 */
+	std::string to_string() const
+	{
+		std::ostringstream ret;
+		for (std::size_t i = 0; i < _size; i++)
+		{
+			Position pos = positionOf(i);
+			ret << _items[pos.page * PAGE_SLOTS + pos.slot] << " ";
+		}
+		return ret.str();
+	}
+};
+
+#endif
@@ -11,17 +11,40 @@
 #include <stdexcept> // std::out_of_range
 #include <math.h>	 // pow()
 #include <string>
-#include <limits>
+#include <sstream>
+#include <functional> // std::less
+#include <utility>	  // std::move, std::forward
+#include <iterator>	  // std::make_move_iterator
+#include <algorithm>  // std::min
+#include "AlignedAllocator.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /**
  *  Declaring Heap class
+ *
+ *  The element with the highest priority is on top: the one no other element compares less than
+ *   under Compare, so the default std::less<T> gives a min-heap. T only has to be move constructible
+ *   and move assignable; elements are moved, never copied, inside the heap.
+ *
+ *  Arity is the number of children per node (2 = binary heap, 4 and 8 for large heaps).
+ *  Node i has children Arity*i + 1 .. Arity*i + Arity. The storage is allocated Arity - 1 element
+ *   slots past a cache-line boundary, so every sibling group starts at a multiple of Arity slots
+ *   from the boundary: a group of Arity * sizeof(T) <= 64 bytes is one cache line, and
+ *   percolateDown touches one line per level instead of one per child.
  */
-template <typename T>
+template <typename T, unsigned int Arity = 2, typename Compare = std::less<T>>
 class Heap
 {
+	static_assert(Arity >= 2, "Heap arity must be at least 2");
+
+public:
+	typedef T value_type;
 
 private:
-	std::vector<T> _items; // Main vector of elements for heap storage. The first item in the array is a placeholder.
+	std::vector<T, AlignedAllocator<T, CACHE_LINE_BYTES, Arity - 1>> _items; // Main vector of elements for heap storage, root first.
+	Compare _compare;
 
 	/*********************************************************************/
 	/*********************** Start assignment zone **********************/
@@ -32,22 +55,41 @@ private:
 	 *  Used for dequeue operations and array to heap conversions
 	 *  TODO: Implement percolateDown
 	 */
-	void percolateDown(unsigned int hole)
+	void percolateDown(size_t hole)
 	{
-		unsigned int child; // child node in question
+		size_t n = _items.size();
 		T tmp = std::move(_items[hole]);
 
-		for ( ; hole *2 < _items.size(); hole = child)
+		for (size_t first = Arity * hole + 1; first < n; first = Arity * hole + 1)
 		{
-			child = hole*2; // the left child is double the index, and right is double + 1 
-			
-			if (child != _items.size() - 1 && _items[child + 1] < _items[child]) {
-            	++child; // right child
+			size_t child = first; // highest priority child so far
+			if (first + Arity <= n)
+			{
+				// full sibling group: fixed trip count, unrolled by the compiler into conditional
+				// moves, since with random keys which child wins is unpredictable
+				const T *group = &_items[first];
+				unsigned int best = 0;
+				for (unsigned int k = 1; k < Arity; ++k)
+				{
+					best = _compare(group[k], group[best]) ? k : best;
+				}
+				child = first + best;
+			}
+			else
+			{
+				for (size_t c = first + 1; c < n; ++c)
+				{
+					if (_compare(_items[c], _items[child]))
+					{
+						child = c;
+					}
+				}
 			}
 
 			// move child up
-			if (_items[child] < tmp) {
+			if (_compare(_items[child], tmp)) {
 				_items[hole] = std::move(_items[child]);
+				hole = child;
 			} else {
             	break;
 			}
@@ -56,101 +98,242 @@ private:
 	}
 
 	/**
-	 *  Add a new item to the end of the heap and percolate up this item to fix heap property
+	 *  Percolate up the item at index hole (just appended at the end) to fix heap property
 	 *  Used in inserting new nodes into the heap
 	 *  TODO: Implement percolateUp
 	 */
-	void percolateUp(const T& item) {
-		int hole = _items.size();  
-		_items.push_back(item);    
+	void percolateUp(size_t hole) {
+		T tmp = std::move(_items[hole]);
 
-		for (; item < _items[hole / 2]; hole /= 2) {
-			_items[hole] = std::move(_items[hole / 2]);
+		for (; hole > 0 && _compare(tmp, _items[(hole - 1) / Arity]); hole = (hole - 1) / Arity) {
+			_items[hole] = std::move(_items[(hole - 1) / Arity]);
 		}
-		_items[hole] = item;
+		_items[hole] = std::move(tmp);
 	}
 
 
 	/********************** End Microassigment zone *********************/
 
+	static const size_t PARALLEL_HEAPIFY_MIN = 1 << 20; // smaller inputs are heapified serially
+
+	/**
+	 *  Floyd's bottom-up construction: percolate every internal node down, last one first.
+	 *  O(n) in total, since most nodes are near the bottom and percolate only a few levels.
+	 */
+	void heapify()
+	{
+		if (_items.size() < 2)
+		{
+			return;
+		}
+#ifdef _OPENMP
+		if (_items.size() >= PARALLEL_HEAPIFY_MIN && omp_get_max_threads() > 1)
+		{
+			parallelHeapify();
+			return;
+		}
+#endif
+		for (size_t i = (_items.size() - 2) / Arity + 1; i-- > 0;)
+		{
+			percolateDown(i);
+		}
+	}
+
+	/**
+	 *  Floyd's construction one tree level at a time, deepest first. The subtrees of the nodes on
+	 *   one level are disjoint, so the nodes of a level are percolated down in parallel.
+	 */
+	void parallelHeapify()
+	{
+		size_t lastParent = (_items.size() - 2) / Arity;
+		std::vector<size_t> levelStart(1, 0); // index of the first node on each level
+		while (levelStart.back() <= lastParent)
+		{
+			levelStart.push_back(levelStart.back() * Arity + 1);
+		}
+		for (size_t level = levelStart.size() - 1; level-- > 0;)
+		{
+			long long lo = levelStart[level];
+			long long hi = std::min(levelStart[level + 1], lastParent + 1);
+#pragma omp parallel for schedule(static) if (hi - lo >= 4096)
+			for (long long i = lo; i < hi; ++i)
+			{
+				percolateDown(i);
+			}
+		}
+	}
+
 public:
 	/**
 	 *  Default empty constructor
 	 */
-	Heap()
+	explicit Heap(const Compare &compare = Compare()) : _compare(compare)
+	{
+	}
+
+	/**
+	 *  Builds a heap from the items in [first, last) in O(n)
+	 */
+	template <typename InputIt>
+	Heap(InputIt first, InputIt last, const Compare &compare = Compare()) : _items(first, last), _compare(compare)
 	{
-		_items.push_back(std::numeric_limits<T>::min()); // Push a placeholder for the first item in the array
+		heapify();
+	}
+
+	/**
+	 *  Builds a heap from the moved-in items in O(n). The elements are moved into the heap's own
+	 *   cache-line aligned storage, so this costs one move per element but no copies.
+	 */
+	explicit Heap(std::vector<T> &&items, const Compare &compare = Compare())
+		: _items(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())), _compare(compare)
+	{
+		items.clear();
+		heapify();
 	}
 
 	/**
 	 *  Adds a new item to the heap
 	 */
-	void push(T item)
+	void push(const T &item)
 	{
-		percolateUp(item);
+		_items.push_back(item);
+		percolateUp(_items.size() - 1);
+	}
+
+	void push(T &&item)
+	{
+		_items.push_back(std::move(item));
+		percolateUp(_items.size() - 1);
 	}
 
 	/**
-	 *  Removes minimum value from heap 
+	 *  Constructs a new item in place from args and adds it to the heap
 	 */
-	T pop()
+	template <typename... Args>
+	void emplace(Args &&...args)
 	{
-		long unsigned int last_index = _items.size() - 1; // Calc last item index
-		int root_index = 1;								  // Root index (for readability)
+		_items.emplace_back(std::forward<Args>(args)...);
+		percolateUp(_items.size() - 1);
+	}
 
+	/**
+	 *  Adds the items in [first, last) to the heap (use std::make_move_iterator to move them in).
+	 *  Percolating each one up costs up to log2(n) levels per item, rebuilding the whole heap
+	 *   about 2n moves, so a batch that is large compared to the heap triggers a rebuild instead.
+	 */
+	template <typename InputIt>
+	void push_range(InputIt first, InputIt last)
+	{
+		size_t oldSize = _items.size();
+		_items.insert(_items.end(), first, last);
+		size_t added = _items.size() - oldSize;
+
+		if (added * log2(_items.size() + 1.0) > _items.size())
+		{
+			heapify();
+		}
+		else
+		{
+			for (size_t i = oldSize; i < _items.size(); ++i)
+			{
+				percolateUp(i);
+			}
+		}
+	}
+
+	/**
+	 *  Replaces the top item with item in one percolateDown, about half the work of pop() and push().
+	 *   A bounded heap that keeps the best N items evicts its worst (its top, under the reversed
+	 *   order) this way.
+	 */
+	void replace_top(const T &item)
+	{
+		T copy(item);
+		replace_top(std::move(copy));
+	}
+
+	void replace_top(T &&item)
+	{
+		if (empty())
+		{
+			throw std::out_of_range("replace_top() - No elements in heap");
+		}
+		_items[0] = std::move(item);
+		percolateDown(0);
+	}
+
+	/**
+	 *  Returns the top item without removing it
+	 */
+	const T &top() const
+	{
+		if (empty())
+		{
+			throw std::out_of_range("top() - No elements in heap");
+		}
+		return _items[0];
+	}
+
+	/**
+	 *  Removes the top (by default minimum) value from heap and moves it out
+	 */
+	T pop()
+	{
 		if (size() == 0)
 		{
 			throw std::out_of_range("pop() - No elements in heap");
 		}
 
-		T minItem = _items[root_index];
+		T topItem = std::move(_items[0]);
 
-		_items[root_index] = _items[last_index]; // Move last item to root
+		if (_items.size() > 1)
+		{
+			_items[0] = std::move(_items.back()); // Move last item to root
+		}
 		_items.pop_back();						 // Erase last element entry
 
-		if (size() > 0)
-		{					  // Only runs if the heap isn't empty now
-			percolateDown(1); // Fix heap property
+		if (size() > 1)
+		{					  // Only runs if there is something to reorder
+			percolateDown(0); // Fix heap property
 		}
-		return minItem;
+		return topItem;
 	}
 
 	/**
 	 *  Returns true if heap is empty, else false
-	 *  Consider the first placeholder in the array
 	 */
 	bool empty() const
 	{
-		if (_items.size() == 1)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
+		return _items.empty();
 	}
 
 	/**
 	 *  Returns current quantity of elements in heap (N)
-	 *  Consider the first placeholder in the array
 	 */
 	long unsigned int size() const
 	{
-		return _items.size() - 1;
+		return _items.size();
+	}
+
+	/**
+	 *  Reserves storage for n elements, so pushes up to n do not reallocate
+	 */
+	void reserve(long unsigned int n)
+	{
+		_items.reserve(n);
 	}
 
 	/**
-	 *  Return heap data in order from the _items vector
+	 *  Return heap data in order from the _items vector; needs operator<< for T
 	 */
 	std::string to_string() const
 	{
-		std::string ret = "";
-		for (unsigned int i = 1; i < _items.size(); i++)
+		std::ostringstream ret;
+		for (size_t i = 0; i < _items.size(); i++)
 		{
-			ret += std::to_string(_items[i]) + " ";
+			ret << _items[i] << " ";
 		}
-		return ret;
+		return ret.str();
 	}
 };
 
@@ -0,0 +1,836 @@
+//***************************************************************************//
+//**
+//**  Heap benchmarks, run with "MA4 bench [maxSize]"
+//**
+//***************************************************************************//
+
+#ifndef __HEAP_BENCHMARK_H
+#define __HEAP_BENCHMARK_H
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <omp.h>
+#include "Heap.h"
+#include "IndexedHeap.h"
+#include "MultiQueue.h"
+#include "RadixHeap.h"
+#include "MinMaxHeap.h"
+#include "TopK.h"
+#include "TimerWheel.h"
+#include "BHeap.h"
+#include <cstdint>
+#include <sys/resource.h>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include "../common/Workload.h"
+
+// ns per operation of push, pop and hold for one heap size; each is the best of `reps` runs
+struct HeapTiming
+{
+    double pushNs;
+    double popNs;
+    double holdNs;
+};
+
+template <unsigned int Arity>
+inline HeapTiming timeHeap(const std::vector<int> &keys, const std::vector<int> &increments, int reps)
+{
+    typedef std::chrono::steady_clock Clock;
+    HeapTiming best = {1e300, 1e300, 1e300};
+    volatile long long sink = 0;
+    size_t n = keys.size();
+
+    for (int r = 0; r < reps; ++r)
+    {
+        Heap<int, Arity> heap;
+        heap.reserve(n);
+
+        Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i < n; ++i)
+        {
+            heap.push(keys[i]);
+        }
+        Clock::time_point end = Clock::now();
+        best.pushNs = std::min(best.pushNs, std::chrono::duration<double, std::nano>(end - begin).count() / n);
+
+        // hold model: pop the earliest event and schedule a later one, as a simulation or timer queue does
+        long long checksum = 0;
+        begin = Clock::now();
+        for (size_t i = 0; i < increments.size(); ++i)
+        {
+            int top = heap.pop();
+            checksum += top;
+            heap.push(top + increments[i]);
+        }
+        end = Clock::now();
+        best.holdNs = std::min(best.holdNs, std::chrono::duration<double, std::nano>(end - begin).count() / increments.size());
+
+        begin = Clock::now();
+        while (!heap.empty())
+        {
+            checksum += heap.pop();
+        }
+        end = Clock::now();
+        best.popNs = std::min(best.popNs, std::chrono::duration<double, std::nano>(end - begin).count() / n);
+        sink = sink + checksum;
+    }
+    return best;
+}
+
+inline void runHeapBenchmark(long long maxSize)
+{
+    const long long MAX_HOLD_OPS = 10000000;
+    std::printf("%12s %6s %12s %12s %12s\n", "size", "arity", "push ns/op", "pop ns/op", "hold ns/op");
+    for (long long n = 1000; n <= maxSize; n *= 10)
+    {
+        // keys leave headroom below INT_MAX for the hold increments
+        std::vector<int> keys = generateKeys(n, 41, KeyWorkload(UNIFORM_KEYS, 0, 1 << 30));
+        std::vector<int> increments = generateKeys(std::min(n, MAX_HOLD_OPS), 42, KeyWorkload(UNIFORM_KEYS, 1, 1 << 20));
+        int reps = (n <= 100000) ? 5 : 1;
+
+        HeapTiming t2 = timeHeap<2>(keys, increments, reps);
+        HeapTiming t4 = timeHeap<4>(keys, increments, reps);
+        HeapTiming t8 = timeHeap<8>(keys, increments, reps);
+        std::printf("%12lld %6d %12.1f %12.1f %12.1f\n", n, 2, t2.pushNs, t2.popNs, t2.holdNs);
+        std::printf("%12lld %6d %12.1f %12.1f %12.1f\n", n, 4, t4.pushNs, t4.popNs, t4.holdNs);
+        std::printf("%12lld %6d %12.1f %12.1f %12.1f\n", n, 8, t8.pushNs, t8.popNs, t8.holdNs);
+    }
+}
+
+// a task whose payload makes copies expensive (an allocation and a memcpy); counts its copies and moves
+struct HeavyTask
+{
+    int priority;
+    std::vector<char> payload;
+
+    // function-local statics, so that the counters need no out-of-line definition
+    static long long &copies()
+    {
+        static long long count = 0;
+        return count;
+    }
+    static long long &moves()
+    {
+        static long long count = 0;
+        return count;
+    }
+
+    HeavyTask(int p, size_t bytes) : priority(p), payload(bytes, 'x') {}
+    HeavyTask(const HeavyTask &rhs) : priority(rhs.priority), payload(rhs.payload) { copies()++; }
+    HeavyTask(HeavyTask &&rhs) noexcept : priority(rhs.priority), payload(std::move(rhs.payload)) { moves()++; }
+    HeavyTask &operator=(const HeavyTask &rhs)
+    {
+        priority = rhs.priority;
+        payload = rhs.payload;
+        copies()++;
+        return *this;
+    }
+    HeavyTask &operator=(HeavyTask &&rhs) noexcept
+    {
+        priority = rhs.priority;
+        payload = std::move(rhs.payload);
+        moves()++;
+        return *this;
+    }
+    bool operator<(const HeavyTask &rhs) const { return priority < rhs.priority; }
+    bool operator>(const HeavyTask &rhs) const { return priority > rhs.priority; }
+};
+
+// push n heavy tasks and pop them all: Heap moves them in and out, std::priority_queue can only
+// hand out a copy of top() before pop()
+inline void runPayloadBenchmark(size_t n, size_t payloadBytes)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::vector<int> priorities = generateKeys(n, 43);
+    long long checksum = 0;
+
+    std::printf("%u tasks with %u-byte payloads\n", (unsigned)n, (unsigned)payloadBytes);
+    std::printf("%24s %12s %12s %14s %14s\n", "", "push ns/op", "pop ns/op", "copies/task", "moves/task");
+
+    // the first pass only warms up the allocator and the page tables
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        {
+            Heap<HeavyTask> heap;
+            HeavyTask::copies() = HeavyTask::moves() = 0;
+            Clock::time_point begin = Clock::now();
+            for (size_t i = 0; i < n; ++i)
+            {
+                heap.emplace(priorities[i], payloadBytes);
+            }
+            Clock::time_point middle = Clock::now();
+            while (!heap.empty())
+            {
+                HeavyTask t = heap.pop();
+                checksum += t.payload.size();
+            }
+            Clock::time_point end = Clock::now();
+            if (pass == 1)
+            {
+                std::printf("%24s %12.1f %12.1f %14.2f %14.2f\n", "Heap emplace/pop",
+                            std::chrono::duration<double, std::nano>(middle - begin).count() / n,
+                            std::chrono::duration<double, std::nano>(end - middle).count() / n,
+                            (double)HeavyTask::copies() / n, (double)HeavyTask::moves() / n);
+            }
+        }
+        {
+            std::priority_queue<HeavyTask, std::vector<HeavyTask>, std::greater<HeavyTask>> queue;
+            HeavyTask::copies() = HeavyTask::moves() = 0;
+            Clock::time_point begin = Clock::now();
+            for (size_t i = 0; i < n; ++i)
+            {
+                HeavyTask task(priorities[i], payloadBytes);
+                queue.push(task);
+            }
+            Clock::time_point middle = Clock::now();
+            while (!queue.empty())
+            {
+                HeavyTask t = queue.top();
+                queue.pop();
+                checksum += t.payload.size();
+            }
+            Clock::time_point end = Clock::now();
+            if (pass == 1)
+            {
+                std::printf("%24s %12.1f %12.1f %14.2f %14.2f\n", "priority_queue copying",
+                            std::chrono::duration<double, std::nano>(middle - begin).count() / n,
+                            std::chrono::duration<double, std::nano>(end - middle).count() / n,
+                            (double)HeavyTask::copies() / n, (double)HeavyTask::moves() / n);
+            }
+        }
+    }
+    if (checksum != (long long)(4 * n * payloadBytes))
+    {
+        std::printf("payload checksum mismatch\n");
+    }
+}
+
+// building a heap of n elements: n pushes versus Floyd heapify, serial and on all threads
+inline void runHeapifyBenchmark(long long maxSize)
+{
+    typedef std::chrono::steady_clock Clock;
+    int threads = omp_get_max_threads();
+    std::printf("%12s %14s %14s %14s (%d threads)\n", "size", "push ms", "heapify ms", "parallel ms", threads);
+    for (long long n = 1000000; n <= maxSize; n *= 10)
+    {
+        std::vector<int> keys = generateKeys(n, 44);
+        double ms[3];
+        for (int variant = 0; variant < 3; ++variant)
+        {
+            omp_set_num_threads(variant == 2 ? threads : 1);
+            Clock::time_point begin = Clock::now();
+            if (variant == 0)
+            {
+                Heap<int, 4> heap;
+                heap.reserve(n);
+                for (long long i = 0; i < n; ++i)
+                {
+                    heap.push(keys[i]);
+                }
+            }
+            else
+            {
+                Heap<int, 4> heap(keys.begin(), keys.end());
+            }
+            ms[variant] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        }
+        omp_set_num_threads(threads);
+        std::printf("%12lld %14.1f %14.1f %14.1f\n", n, ms[0], ms[1], ms[2]);
+    }
+}
+
+struct DijkstraRun
+{
+    std::vector<long long> dist;
+    double ms;
+    size_t peak;    // most queued entries at any time
+    long long stale;
+};
+
+// Dijkstra that pushes a new (distance, vertex) entry per improvement and skips outdated ones when popped;
+// the edges of v are [v * degree, (v + 1) * degree)
+template <typename QueueType>
+inline DijkstraRun lazyDijkstra(int numVertices, int degree, const std::vector<int> &target, const std::vector<int> &weight)
+{
+    typedef std::pair<long long, int> QueueEntry;
+    DijkstraRun run;
+    run.dist.assign(numVertices, std::numeric_limits<long long>::max());
+    run.peak = 0;
+    run.stale = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    QueueType queue;
+    run.dist[0] = 0;
+    queue.push(QueueEntry(0, 0));
+    while (!queue.empty())
+    {
+        run.peak = std::max(run.peak, (size_t)queue.size());
+        QueueEntry top = queue.pop();
+        int v = top.second;
+        if (top.first > run.dist[v])
+        {
+            run.stale++;
+            continue;
+        }
+        for (long long e = (long long)v * degree; e < (long long)(v + 1) * degree; ++e)
+        {
+            long long d = run.dist[v] + weight[e];
+            if (d < run.dist[target[e]])
+            {
+                run.dist[target[e]] = d;
+                queue.push(QueueEntry(d, target[e]));
+            }
+        }
+    }
+    run.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return run;
+}
+
+// single-source shortest paths on a random graph with numVertices * degree edges, once with an
+// IndexedHeap and decrease-key, once with a plain Heap that gets a new entry per improvement and
+// skips the stale ones when they surface
+inline void runDijkstraBenchmark(int numVertices, int degree)
+{
+    typedef std::chrono::steady_clock Clock;
+    typedef std::pair<long long, int> QueueEntry; // distance, vertex
+    const long long UNREACHED = std::numeric_limits<long long>::max();
+
+    long long numEdges = (long long)numVertices * degree; // edges of v are [v * degree, (v + 1) * degree)
+    std::vector<int> target = generateKeys(numEdges, 45, KeyWorkload(UNIFORM_KEYS, 0, numVertices - 1));
+    std::vector<int> weight = generateKeys(numEdges, 46, KeyWorkload(UNIFORM_KEYS, 1, 1000));
+
+    std::vector<long long> distIndexed(numVertices, UNREACHED);
+    size_t peakIndexed = 0;
+    Clock::time_point begin = Clock::now();
+    {
+        IndexedHeap<long long, 4> queue(numVertices);
+        distIndexed[0] = 0;
+        queue.push(0, 0);
+        while (!queue.empty())
+        {
+            peakIndexed = std::max(peakIndexed, (size_t)queue.size());
+            int v = (int)queue.pop().first;
+            for (long long e = (long long)v * degree; e < (long long)(v + 1) * degree; ++e)
+            {
+                long long d = distIndexed[v] + weight[e];
+                if (d < distIndexed[target[e]])
+                {
+                    distIndexed[target[e]] = d;
+                    queue.pushOrUpdate(target[e], d);
+                }
+            }
+        }
+    }
+    double indexedMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    DijkstraRun lazy = lazyDijkstra<Heap<QueueEntry, 4>>(numVertices, degree, target, weight);
+    DijkstraRun radix = lazyDijkstra<RadixHeap<QueueEntry>>(numVertices, degree, target, weight);
+
+    // IndexedHeap entries are a long long priority and a size_t handle, plus a size_t per vertex
+    double indexedMB = (peakIndexed * (sizeof(long long) + sizeof(size_t)) + numVertices * sizeof(size_t)) / 1e6;
+    bool agree = (distIndexed == lazy.dist) && (distIndexed == radix.dist);
+    std::printf("Dijkstra, %d vertices, %lld edges%s\n", numVertices, numEdges, agree ? "" : " (DISTANCES DIFFER)");
+    std::printf("%24s %10s %14s %12s %14s\n", "", "ms", "peak entries", "peak MB", "stale pops");
+    std::printf("%24s %10.1f %14zu %12.1f %14d\n", "IndexedHeap update", indexedMs, peakIndexed, indexedMB, 0);
+    std::printf("%24s %10.1f %14zu %12.1f %14lld\n", "Heap lazy deletion", lazy.ms, lazy.peak, lazy.peak * sizeof(QueueEntry) / 1e6, lazy.stale);
+    std::printf("%24s %10.1f %14zu %12.1f %14lld\n", "RadixHeap lazy deletion", radix.ms, radix.peak, radix.peak * sizeof(QueueEntry) / 1e6, radix.stale);
+}
+
+// rank error of MultiQueue pops: n distinct keys, half of them queued, then pop / push pairs; the
+// rank of a popped key is the number of queued keys smaller than it (0 for an exact queue), counted
+// with a Fenwick tree. Run on one thread, since the error depends on the number of shards rather
+// than on how many threads share them.
+inline void runMultiQueueQuality(int n)
+{
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; ++i)
+    {
+        keys[i] = i;
+    }
+    WorkloadRng rng(47);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::printf("%12s %16s %16s\n", "shards", "mean rank error", "max rank error");
+    for (unsigned int shards = 2; shards <= 64; shards *= 2)
+    {
+        MultiQueue<int> queue(shards, 1);
+        std::vector<int> fenwick(n + 1, 0);
+        auto add = [&](int key, int delta) { for (int i = key + 1; i <= n; i += i & -i) fenwick[i] += delta; };
+        auto smaller = [&](int key) { int c = 0; for (int i = key; i > 0; i -= i & -i) c += fenwick[i]; return c; };
+
+        int next = 0;
+        for (; next < n / 2; ++next)
+        {
+            queue.push(keys[next]);
+            add(keys[next], 1);
+        }
+        long long total = 0;
+        int worst = 0;
+        int pops = 0;
+        int popped;
+        while (queue.tryPop(popped))
+        {
+            int rank = smaller(popped);
+            add(popped, -1);
+            total += rank;
+            worst = std::max(worst, rank);
+            pops++;
+            if (next < n)
+            {
+                queue.push(keys[next]);
+                add(keys[next], 1);
+                next++;
+            }
+        }
+        std::printf("%12u %16.2f %16d\n", shards, (double)total / pops, worst);
+    }
+}
+
+// throughput of push / pop pairs from 1 .. all hardware threads, MultiQueue versus one Heap behind a mutex
+inline void runMultiQueueScaling(long long opsPerThread)
+{
+    typedef std::chrono::steady_clock Clock;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int t = 1; t < maxThreads; t *= 2)
+    {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+    std::vector<int> prefill = generateKeys(1000000, 48);
+
+    std::printf("%12s %18s %18s\n", "threads", "MultiQueue Mops/s", "mutex Heap Mops/s");
+    for (size_t k = 0; k < threadCounts.size(); ++k)
+    {
+        unsigned int numThreads = threadCounts[k];
+        double mops[2];
+        for (int variant = 0; variant < 2; ++variant)
+        {
+            MultiQueue<int> multi(numThreads);
+            Heap<int, 4> single(prefill.begin(), prefill.end());
+            std::mutex singleLock;
+            for (size_t i = 0; variant == 0 && i < prefill.size(); ++i)
+            {
+                multi.push(prefill[i]);
+            }
+
+            std::vector<std::thread> workers;
+            Clock::time_point begin = Clock::now();
+            for (unsigned int t = 0; t < numThreads; ++t)
+            {
+                workers.push_back(std::thread([&, t]() {
+                    WorkloadRng rng(1000 + t);
+                    int item;
+                    for (long long i = 0; i < opsPerThread; ++i)
+                    {
+                        int key = (int)rng.below(1 << 30);
+                        if (variant == 0)
+                        {
+                            multi.push(key);
+                            multi.tryPop(item);
+                        }
+                        else
+                        {
+                            std::lock_guard<std::mutex> guard(singleLock);
+                            single.push(key);
+                            item = single.pop();
+                        }
+                    }
+                }));
+            }
+            for (size_t t = 0; t < workers.size(); ++t)
+            {
+                workers[t].join();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            mops[variant] = 2.0 * opsPerThread * numThreads / seconds / 1e6;
+        }
+        std::printf("%12u %18.2f %18.2f\n", numThreads, mops[0], mops[1]);
+    }
+}
+
+// hold model with monotone timestamps, as in a discrete event simulation: pop the earliest event and
+// schedule one up to 2^20 later; binary and 4-ary Heap versus RadixHeap
+template <typename HeapType>
+inline double timeMonotoneHold(const std::vector<unsigned int> &keys, const std::vector<unsigned int> &increments)
+{
+    HeapType heap;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        heap.push(keys[i]);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < increments.size(); ++i)
+    {
+        unsigned int t = heap.pop();
+        heap.push(t + increments[i]);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / increments.size();
+}
+
+inline void runRadixHeapBenchmark(long long maxSize)
+{
+    const long long MAX_HOLD_OPS = 10000000;
+    std::printf("%12s %16s %16s %16s\n", "size", "Heap<2> ns/op", "Heap<4> ns/op", "RadixHeap ns/op");
+    for (long long n = 1000; n <= maxSize; n *= 10)
+    {
+        std::vector<int> k = generateKeys(n, 49, KeyWorkload(UNIFORM_KEYS, 0, 1 << 30));
+        std::vector<int> inc = generateKeys(std::min(n, MAX_HOLD_OPS), 50, KeyWorkload(UNIFORM_KEYS, 0, 1 << 20));
+        std::vector<unsigned int> keys(k.begin(), k.end());
+        std::vector<unsigned int> increments(inc.begin(), inc.end());
+        std::printf("%12lld %16.1f %16.1f %16.1f\n", n, timeMonotoneHold<Heap<unsigned int, 2>>(keys, increments),
+                    timeMonotoneHold<Heap<unsigned int, 4>>(keys, increments), timeMonotoneHold<RadixHeap<unsigned int>>(keys, increments));
+    }
+}
+
+// keep the k smallest of a stream of random keys while serving the best (smallest) one every 1024
+// elements: a bounded MinMaxHeap versus a min-heap and a max-heap over the same items, kept in step
+// by erasing the evicted item's handle from the min-heap
+inline void runTopKBenchmark(long long streamLength)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::printf("top-k of %lld random keys\n", streamLength);
+    std::printf("%12s %18s %18s\n", "k", "MinMaxHeap ms", "two heaps ms");
+    for (long long k = 100; k <= 1000000; k *= 100)
+    {
+        long long served[2] = {0, 0};
+        std::vector<unsigned int> kept[2];
+
+        Clock::time_point begin = Clock::now();
+        MinMaxHeap<unsigned int> buffer(k);
+        for (long long i = 0; i < streamLength; ++i)
+        {
+            buffer.push((unsigned int)counterHash(51, i));
+            if ((i & 1023) == 0)
+            {
+                served[0] += buffer.findMin();
+            }
+        }
+        double minMaxMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        while (!buffer.empty())
+        {
+            kept[0].push_back(buffer.popMin());
+        }
+
+        // handle h names slot h of the buffer; both heaps index the same k slots
+        begin = Clock::now();
+        IndexedHeap<unsigned int, 4> minHeap(k);
+        IndexedHeap<unsigned int, 4, std::greater<unsigned int>> maxHeap(k);
+        for (long long i = 0; i < streamLength; ++i)
+        {
+            unsigned int key = (unsigned int)counterHash(51, i);
+            if ((long long)maxHeap.size() < k)
+            {
+                minHeap.push(maxHeap.size(), key);
+                maxHeap.push(maxHeap.size(), key);
+            }
+            else if (key < maxHeap.topPriority())
+            {
+                size_t slot = maxHeap.topHandle();
+                maxHeap.update(slot, key);
+                minHeap.erase(slot);
+                minHeap.push(slot, key);
+            }
+            if ((i & 1023) == 0)
+            {
+                served[1] += minHeap.topPriority();
+            }
+        }
+        double twoHeapMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        while (!minHeap.empty())
+        {
+            kept[1].push_back(minHeap.pop().second);
+        }
+
+        bool agree = (kept[0] == kept[1]) && (served[0] == served[1]);
+        std::printf("%12lld %18.1f %18.1f%s\n", k, minMaxMs, twoHeapMs, agree ? "" : "  (RESULTS DIFFER)");
+    }
+}
+
+// k largest of n random ints with topK(): one thread and all threads with the scalar scan, all threads
+// with the vector prefilter, and std::nth_element plus a sort of the k on a copy, where the copy fits
+inline void runParallelTopKBenchmark(long long n)
+{
+    typedef std::chrono::steady_clock Clock;
+    const long long MAX_COPY = 1LL << 28;
+    int threads = omp_get_max_threads();
+    TopKKernel vectorKernel = topKBestKernel();
+    std::vector<int> data = generateKeys(n, 52, KeyWorkload(UNIFORM_KEYS, INT_MIN + 1, INT_MAX));
+    std::printf("top-k of %lld random ints (%d threads, %s prefilter)\n", n, threads, topKKernelName(vectorKernel));
+    std::printf("%10s %16s %16s %16s %16s\n", "k", "1 thread ms", "scalar ms", "prefilter ms", "nth_element ms");
+    for (long long k = 10; k <= 1000000; k *= 10)
+    {
+        std::vector<int> result[3];
+        double ms[4] = {0, 0, 0, -1};
+        for (int variant = 0; variant < 3; ++variant)
+        {
+            omp_set_num_threads(variant == 0 ? 1 : threads);
+            Clock::time_point begin = Clock::now();
+            result[variant] = topK(data.data(), n, k, std::greater<int>(), variant == 2 ? vectorKernel : TOP_K_SCALAR_KERNEL);
+            ms[variant] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        }
+        omp_set_num_threads(threads);
+        bool agree = (result[0] == result[1]) && (result[1] == result[2]);
+        if (n <= MAX_COPY)
+        {
+            Clock::time_point begin = Clock::now();
+            std::vector<int> copy(data);
+            std::nth_element(copy.begin(), copy.begin() + (k - 1), copy.end(), std::greater<int>());
+            std::sort(copy.begin(), copy.begin() + k, std::greater<int>());
+            ms[3] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            agree = agree && std::equal(result[0].begin(), result[0].end(), copy.begin());
+        }
+        std::printf("%10lld %16.1f %16.1f %16.1f", k, ms[0], ms[1], ms[2]);
+        if (ms[3] >= 0)
+        {
+            std::printf(" %16.1f", ms[3]);
+        }
+        else
+        {
+            std::printf(" %16s", "-");
+        }
+        std::printf("%s\n", agree ? "" : "  (RESULTS DIFFER)");
+    }
+}
+
+// timer queue simulation: each tick arms armsPerTick timeouts of 2 .. 30000 ticks, cancels the ones
+// whose request finished this tick and fires the ones due. A fraction cancelPercent of the timers is
+// cancelled before its deadline, at a uniformly random tick. The queues are a Heap of (deadline, id)
+// that skips cancelled ids when they reach the top, an IndexedHeap that erases them, and a TimerWheel
+inline void runTimerBenchmark(int ticks, int armsPerTick)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int MAX_TIMEOUT = 30000;
+    size_t total = (size_t)ticks * armsPerTick;
+    std::printf("timer queues, %d ticks, %d arms per tick\n", ticks, armsPerTick);
+    std::printf("%10s %12s %12s %16s %16s %16s\n", "cancel %", "cancels", "fires", "lazy Heap ms", "IndexedHeap ms", "TimerWheel ms");
+    int cancelPercents[] = {0, 50, 90, 99};
+    for (int cancelPercent : cancelPercents)
+    {
+        // timer i is armed at tick i / armsPerTick; its cancels are listed by tick, CSR style
+        std::vector<uint64_t> deadline(total);
+        std::vector<int> cancelTick(total, -1);
+        std::vector<size_t> cancelStart(ticks + 1, 0);
+        for (size_t i = 0; i < total; ++i)
+        {
+            WorkloadRng rng = WorkloadRng::forIndex(53, i);
+            int armed = i / armsPerTick;
+            int timeout = rng.between(2, MAX_TIMEOUT);
+            deadline[i] = armed + timeout;
+            if ((int)rng.below(100) < cancelPercent && armed + timeout - 1 < ticks)
+            {
+                cancelTick[i] = armed + 1 + rng.below(timeout - 1);
+                cancelStart[cancelTick[i] + 1]++;
+            }
+        }
+        for (int t = 0; t < ticks; ++t)
+        {
+            cancelStart[t + 1] += cancelStart[t];
+        }
+        std::vector<uint32_t> cancels(cancelStart[ticks]);
+        std::vector<size_t> cursor(cancelStart.begin(), cancelStart.end() - 1);
+        for (size_t i = 0; i < total; ++i)
+        {
+            if (cancelTick[i] >= 0)
+            {
+                cancels[cursor[cancelTick[i]]++] = i;
+            }
+        }
+
+        long long fires[3] = {0, 0, 0};
+        unsigned long long fireSum[3] = {0, 0, 0};
+        double ms[3];
+
+        Clock::time_point begin = Clock::now();
+        {
+            Heap<std::pair<uint64_t, uint32_t>, 4> heap;
+            std::vector<char> cancelled(total, 0);
+            size_t next = 0;
+            for (int t = 0; t < ticks; ++t)
+            {
+                for (int a = 0; a < armsPerTick; ++a, ++next)
+                {
+                    heap.push(std::make_pair(deadline[next], (uint32_t)next));
+                }
+                for (size_t c = cancelStart[t]; c < cancelStart[t + 1]; ++c)
+                {
+                    cancelled[cancels[c]] = 1;
+                }
+                while (!heap.empty() && heap.top().first <= (uint64_t)t)
+                {
+                    uint32_t id = heap.pop().second;
+                    if (!cancelled[id])
+                    {
+                        fires[0]++;
+                        fireSum[0] += id;
+                    }
+                }
+            }
+        }
+        ms[0] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        begin = Clock::now();
+        {
+            IndexedHeap<uint64_t, 4> heap(total);
+            size_t next = 0;
+            for (int t = 0; t < ticks; ++t)
+            {
+                for (int a = 0; a < armsPerTick; ++a, ++next)
+                {
+                    heap.push(next, deadline[next]);
+                }
+                for (size_t c = cancelStart[t]; c < cancelStart[t + 1]; ++c)
+                {
+                    heap.erase(cancels[c]);
+                }
+                while (!heap.empty() && heap.topPriority() <= (uint64_t)t)
+                {
+                    fires[1]++;
+                    fireSum[1] += heap.pop().first;
+                }
+            }
+        }
+        ms[1] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        begin = Clock::now();
+        {
+            TimerWheel<uint32_t> wheel;
+            std::vector<TimerWheel<uint32_t>::TimerId> ids(total);
+            std::vector<uint32_t> expired;
+            size_t next = 0;
+            for (int t = 0; t < ticks; ++t)
+            {
+                for (int a = 0; a < armsPerTick; ++a, ++next)
+                {
+                    ids[next] = wheel.schedule(deadline[next], (uint32_t)next);
+                }
+                for (size_t c = cancelStart[t]; c < cancelStart[t + 1]; ++c)
+                {
+                    wheel.cancel(ids[cancels[c]]);
+                }
+                expired.clear();
+                fires[2] += wheel.advance(t, expired);
+                for (size_t e = 0; e < expired.size(); ++e)
+                {
+                    fireSum[2] += expired[e];
+                }
+            }
+        }
+        ms[2] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        bool agree = fires[0] == fires[1] && fires[1] == fires[2] && fireSum[0] == fireSum[1] && fireSum[1] == fireSum[2];
+        std::printf("%10d %12zu %12lld %16.1f %16.1f %16.1f%s\n", cancelPercent, cancels.size(), fires[0], ms[0], ms[1], ms[2],
+                    agree ? "" : "  (RESULTS DIFFER)");
+    }
+}
+
+// distinct pages a heap reads per operation: the comparator records the page of every element it
+// compares, except the percolating item itself, which sits on the stack near the comparator's frame
+struct PageTouches
+{
+    bool counting;
+    std::vector<uintptr_t> pages;
+};
+
+struct PageCountingLess
+{
+    PageTouches *touches;
+
+    void record(const int &x) const
+    {
+        char here;
+        uintptr_t addr = (uintptr_t)&x;
+        if (addr - (uintptr_t)&here + (1 << 20) >= (2u << 20))
+        {
+            touches->pages.push_back(addr / PAGE_BYTES);
+        }
+    }
+
+    bool operator()(const int &a, const int &b) const
+    {
+        if (touches->counting)
+        {
+            record(a);
+            record(b);
+        }
+        return a < b;
+    }
+};
+
+inline long pageFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// push all keys, then pop them all; then pages per pop over the first pops of a counting copy
+template <typename HeapType, typename CountingType>
+inline void timeHeapLayout(const char *name, const std::vector<int> &keys)
+{
+    typedef std::chrono::steady_clock Clock;
+    const size_t COUNTED_POPS = 10000;
+    size_t n = keys.size();
+    double ns[2];
+    long faults[2];
+    {
+        HeapType heap;
+        for (int phase = 0; phase < 2; ++phase)
+        {
+            long faultsBefore = pageFaults();
+            Clock::time_point begin = Clock::now();
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (phase == 0)
+                {
+                    heap.push(keys[i]);
+                }
+                else
+                {
+                    heap.pop();
+                }
+            }
+            ns[phase] = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / n;
+            faults[phase] = pageFaults() - faultsBefore;
+        }
+    }
+
+    PageTouches touches;
+    touches.counting = false;
+    PageCountingLess counter = {&touches};
+    CountingType heap(counter);
+    for (size_t i = 0; i < n; ++i)
+    {
+        heap.push(keys[i]);
+    }
+    touches.counting = true;
+    size_t pages = 0;
+    size_t pops = std::min(n, COUNTED_POPS);
+    for (size_t i = 0; i < pops; ++i)
+    {
+        touches.pages.clear();
+        heap.pop();
+        std::sort(touches.pages.begin(), touches.pages.end());
+        pages += std::unique(touches.pages.begin(), touches.pages.end()) - touches.pages.begin();
+    }
+    std::printf("%12zu %12s %10.1f %10.1f %11.2f %12ld %12ld\n", n, name, ns[0], ns[1], (double)pages / pops, faults[0], faults[1]);
+}
+
+// binary and 4-ary Heap against the page-blocked BHeap. Under memory pressure every page an operation
+// reads that is not resident is a fault, so pages/pop bounds the faults per pop of a paged-out heap;
+// the fault columns count the faults actually taken while pushing and while popping
+inline void runBHeapBenchmark(long long maxSize)
+{
+    std::printf("%12s %12s %10s %10s %11s %12s %12s\n", "size", "layout", "push ns", "pop ns", "pages/pop", "push faults", "pop faults");
+    for (long long n = 1000000; n <= maxSize; n *= 10)
+    {
+        std::vector<int> keys = generateKeys(n, 54);
+        timeHeapLayout<Heap<int, 2>, Heap<int, 2, PageCountingLess>>("Heap<2>", keys);
+        timeHeapLayout<Heap<int, 4>, Heap<int, 4, PageCountingLess>>("Heap<4>", keys);
+        timeHeapLayout<BHeap<int>, BHeap<int, PageCountingLess>>("BHeap", keys);
+    }
+}
+
+#endif
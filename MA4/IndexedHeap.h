@@ -0,0 +1,244 @@
+//***************************************************************************//
+//**
+//**  Indexed heap: priority queue of handles with update and erase
+//**
+//***************************************************************************//
+
+#ifndef __INDEXED_HEAP_H
+#define __INDEXED_HEAP_H
+#include <vector>
+#include <string>
+#include <stdexcept> // std::out_of_range, std::invalid_argument
+#include <functional> // std::less
+#include <utility>	  // std::pair, std::move
+#include "AlignedAllocator.h"
+
+/**
+ *  Declaring IndexedHeap class
+ *
+ *  Holds at most one entry per handle, a small integer naming an outside object (a graph vertex,
+ *   a task slot), together with its priority. A position map from handle to heap slot lets
+ *   update(handle, priority) and erase(handle) find the entry and percolate it in O(log n), so
+ *   callers never push duplicates and skip stale entries as with a plain Heap.
+ *  Ordering, arity and layout are as in Heap: the top entry is the one no other entry's priority
+ *   compares less than, and sibling groups of entries share a cache line.
+ *  Memory is one entry per queued handle plus one size_t per handle ever used.
+ */
+template <typename Priority, unsigned int Arity = 4, typename Compare = std::less<Priority>>
+class IndexedHeap
+{
+	static_assert(Arity >= 2, "IndexedHeap arity must be at least 2");
+
+public:
+	static const size_t NOT_IN_HEAP = static_cast<size_t>(-1);
+
+private:
+	struct Entry
+	{
+		Priority priority;
+		size_t handle;
+	};
+
+	std::vector<Entry, AlignedAllocator<Entry, CACHE_LINE_BYTES, Arity - 1>> _items; // heap of entries, root first
+	std::vector<size_t> _position;													  // handle -> slot in _items, or NOT_IN_HEAP
+	Compare _compare;
+
+	void place(size_t slot, Entry &&entry)
+	{
+		_position[entry.handle] = slot;
+		_items[slot] = std::move(entry);
+	}
+
+	void percolateDown(size_t hole)
+	{
+		size_t n = _items.size();
+		Entry tmp = std::move(_items[hole]);
+
+		for (size_t first = Arity * hole + 1; first < n; first = Arity * hole + 1)
+		{
+			size_t child = first;
+			size_t last = (first + Arity <= n) ? first + Arity : n;
+			for (size_t c = first + 1; c < last; ++c)
+			{
+				child = _compare(_items[c].priority, _items[child].priority) ? c : child;
+			}
+
+			if (_compare(_items[child].priority, tmp.priority)) {
+				place(hole, std::move(_items[child]));
+				hole = child;
+			} else {
+				break;
+			}
+		}
+		place(hole, std::move(tmp));
+	}
+
+	void percolateUp(size_t hole)
+	{
+		Entry tmp = std::move(_items[hole]);
+
+		for (; hole > 0 && _compare(tmp.priority, _items[(hole - 1) / Arity].priority); hole = (hole - 1) / Arity) {
+			place(hole, std::move(_items[(hole - 1) / Arity]));
+		}
+		place(hole, std::move(tmp));
+	}
+
+	// after the entry at slot changed priority (or was replaced), restore the heap property
+	void fix(size_t slot)
+	{
+		if (slot > 0 && _compare(_items[slot].priority, _items[(slot - 1) / Arity].priority))
+		{
+			percolateUp(slot);
+		}
+		else
+		{
+			percolateDown(slot);
+		}
+	}
+
+	size_t slotOf(size_t handle, const char *caller) const
+	{
+		if (!contains(handle))
+		{
+			throw std::out_of_range(std::string(caller) + " - handle not in heap");
+		}
+		return _position[handle];
+	}
+
+public:
+	/**
+	 *  Empty heap; handles below numHandles need no resizing of the position map
+	 */
+	explicit IndexedHeap(size_t numHandles = 0, const Compare &compare = Compare())
+		: _position(numHandles, NOT_IN_HEAP), _compare(compare)
+	{
+	}
+
+	bool contains(size_t handle) const
+	{
+		return handle < _position.size() && _position[handle] != NOT_IN_HEAP;
+	}
+
+	/**
+	 *  Adds handle with the given priority; the handle must not be in the heap yet
+	 */
+	void push(size_t handle, const Priority &priority)
+	{
+		if (contains(handle))
+		{
+			throw std::invalid_argument("push() - handle already in heap");
+		}
+		if (handle >= _position.size())
+		{
+			_position.resize(handle + 1, NOT_IN_HEAP);
+		}
+		Entry entry = {priority, handle};
+		_items.push_back(std::move(entry));
+		_position[handle] = _items.size() - 1;
+		percolateUp(_items.size() - 1);
+	}
+
+	/**
+	 *  Changes the priority of a handle in the heap (decrease-key or increase-key)
+	 */
+	void update(size_t handle, const Priority &priority)
+	{
+		size_t slot = slotOf(handle, "update()");
+		_items[slot].priority = priority;
+		fix(slot);
+	}
+
+	/**
+	 *  push() for a new handle, update() for one already in the heap
+	 */
+	void pushOrUpdate(size_t handle, const Priority &priority)
+	{
+		if (contains(handle))
+		{
+			update(handle, priority);
+		}
+		else
+		{
+			push(handle, priority);
+		}
+	}
+
+	/**
+	 *  Removes a handle from anywhere in the heap
+	 */
+	void erase(size_t handle)
+	{
+		size_t slot = slotOf(handle, "erase()");
+		_position[handle] = NOT_IN_HEAP;
+		if (slot + 1 < _items.size())
+		{
+			_items[slot] = std::move(_items.back()); // Move last entry into the hole
+			_items.pop_back();
+			fix(slot);
+		}
+		else
+		{
+			_items.pop_back();
+		}
+	}
+
+	const Priority &priority(size_t handle) const
+	{
+		return _items[slotOf(handle, "priority()")].priority;
+	}
+
+	size_t topHandle() const
+	{
+		if (empty())
+		{
+			throw std::out_of_range("topHandle() - No elements in heap");
+		}
+		return _items[0].handle;
+	}
+
+	const Priority &topPriority() const
+	{
+		if (empty())
+		{
+			throw std::out_of_range("topPriority() - No elements in heap");
+		}
+		return _items[0].priority;
+	}
+
+	/**
+	 *  Removes the top entry and returns its handle and priority
+	 */
+	std::pair<size_t, Priority> pop()
+	{
+		if (empty())
+		{
+			throw std::out_of_range("pop() - No elements in heap");
+		}
+		std::pair<size_t, Priority> top(_items[0].handle, std::move(_items[0].priority));
+		erase(top.first);
+		return top;
+	}
+
+	bool empty() const
+	{
+		return _items.empty();
+	}
+
+	long unsigned int size() const
+	{
+		return _items.size();
+	}
+
+	/**
+	 *  Bytes held by the heap array and the position map
+	 */
+	long unsigned int memoryBytes() const
+	{
+		return _items.capacity() * sizeof(Entry) + _position.capacity() * sizeof(size_t);
+	}
+};
+
+template <typename Priority, unsigned int Arity, typename Compare>
+const size_t IndexedHeap<Priority, Arity, Compare>::NOT_IN_HEAP;
+
+#endif
@@ -0,0 +1,269 @@
+//***************************************************************************//
+//**
+//**  Min-max heap: double-ended priority queue with an optional bound
+//**
+//***************************************************************************//
+
+#ifndef __MIN_MAX_HEAP_H
+#define __MIN_MAX_HEAP_H
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>  // std::out_of_range
+#include <functional> // std::less
+#include <utility>	  // std::move, std::swap, std::forward
+
+/**
+ *  Declaring MinMaxHeap class
+ *
+ *  Atkinson, Sack, Santoro and Strothotte's min-max heap (1986): one array in heap shape whose even
+ *   levels (the root is level 0) are min levels and odd levels max levels. A node on a min level is
+ *   no greater than anything below it, a node on a max level no smaller. So the minimum is the root
+ *   and the maximum one of its two children: findMin/findMax are O(1), push/popMin/popMax O(log n).
+ *
+ *  With a capacity, the heap is a bounded "best N" buffer that keeps the capacity smallest items
+ *   under Compare (use std::greater to keep the largest). Once full, push() replaces the current
+ *   maximum, the worst item, if the new item is better, and drops the new item otherwise.
+ */
+template <typename T, typename Compare = std::less<T>>
+class MinMaxHeap
+{
+public:
+	typedef T value_type;
+
+private:
+	std::vector<T> _items; // level order, root first
+	size_t _capacity;	   // 0 = unbounded
+	size_t _maxSlot;	   // index of the maximum, kept so a full buffer rejects an item with one comparison
+	Compare _compare;
+
+	static bool isMinLevel(size_t i)
+	{
+		int level = 63 - __builtin_clzll(static_cast<unsigned long long>(i + 1));
+		return level % 2 == 0;
+	}
+
+	// on a min level "better" is less, on a max level greater
+	bool better(const T &a, const T &b, bool minLevel) const
+	{
+		return minLevel ? _compare(a, b) : _compare(b, a);
+	}
+
+	// move the item at i up through the grandparents on its own kind of level
+	void percolateUpLevels(size_t i, bool minLevel)
+	{
+		while (i >= 3)
+		{
+			size_t grandparent = ((i - 1) / 2 - 1) / 2;
+			if (!better(_items[i], _items[grandparent], minLevel))
+			{
+				break;
+			}
+			std::swap(_items[i], _items[grandparent]);
+			i = grandparent;
+		}
+	}
+
+	void percolateUp(size_t i)
+	{
+		if (i == 0)
+		{
+			return;
+		}
+		size_t parent = (i - 1) / 2;
+		bool minLevel = isMinLevel(i);
+		if (better(_items[parent], _items[i], minLevel))
+		{
+			// the item belongs on the other kind of level
+			std::swap(_items[i], _items[parent]);
+			percolateUpLevels(parent, !minLevel);
+		}
+		else
+		{
+			percolateUpLevels(i, minLevel);
+		}
+	}
+
+	// restore the order below i after _items[i] was replaced
+	void percolateDown(size_t i)
+	{
+		bool minLevel = isMinLevel(i);
+		size_t n = _items.size();
+		while (2 * i + 1 < n)
+		{
+			// best of the children and grandchildren
+			size_t m = 2 * i + 1;
+			size_t candidates[] = {2 * i + 2, 4 * i + 3, 4 * i + 4, 4 * i + 5, 4 * i + 6};
+			for (size_t c : candidates)
+			{
+				if (c < n && better(_items[c], _items[m], minLevel))
+				{
+					m = c;
+				}
+			}
+			if (!better(_items[m], _items[i], minLevel))
+			{
+				return;
+			}
+			std::swap(_items[i], _items[m]);
+			if (m <= 2 * i + 2)
+			{
+				return; // a child: it has no grandchildren of i's kind to violate
+			}
+			size_t parent = (m - 1) / 2;
+			if (better(_items[parent], _items[m], minLevel))
+			{
+				std::swap(_items[m], _items[parent]);
+			}
+			i = m;
+		}
+	}
+
+	size_t maxIndex() const
+	{
+		if (_items.size() <= 2)
+		{
+			return _items.size() - 1;
+		}
+		return _compare(_items[1], _items[2]) ? 2 : 1;
+	}
+
+	T removeAt(size_t i)
+	{
+		T item = std::move(_items[i]);
+		if (i + 1 < _items.size())
+		{
+			_items[i] = std::move(_items.back());
+			_items.pop_back();
+			percolateDown(i);
+		}
+		else
+		{
+			_items.pop_back();
+		}
+		_maxSlot = maxIndex();
+		return item;
+	}
+
+	bool insert(T &&item)
+	{
+		if (_capacity == 0 || _items.size() < _capacity)
+		{
+			_items.push_back(std::move(item));
+			percolateUp(_items.size() - 1);
+			_maxSlot = maxIndex();
+			return true;
+		}
+		size_t worst = _maxSlot;
+		if (!_compare(item, _items[worst]))
+		{
+			return false;
+		}
+		_items[worst] = std::move(item);
+		// the new item may be smaller than the root above it; the old root then moves down instead
+		if (worst > 0 && _compare(_items[worst], _items[0]))
+		{
+			std::swap(_items[worst], _items[0]);
+		}
+		percolateDown(worst);
+		_maxSlot = maxIndex();
+		return true;
+	}
+
+	void checkNotEmpty(const char *caller) const
+	{
+		if (empty())
+		{
+			throw std::out_of_range(std::string(caller) + " - No elements in heap");
+		}
+	}
+
+public:
+	/**
+	 *  Empty heap; with capacity > 0 it never holds more than capacity items
+	 */
+	explicit MinMaxHeap(size_t capacity = 0, const Compare &compare = Compare()) : _capacity(capacity), _maxSlot(0), _compare(compare)
+	{
+		_items.reserve(capacity);
+	}
+
+	/**
+	 *  Adds a new item. Returns false if the heap is full and the item is not better than the
+	 *   maximum, so it was dropped; a true return may have evicted the old maximum.
+	 */
+	bool push(const T &item)
+	{
+		T copy(item);
+		return insert(std::move(copy));
+	}
+
+	bool push(T &&item)
+	{
+		return insert(std::move(item));
+	}
+
+	template <typename... Args>
+	bool emplace(Args &&...args)
+	{
+		return insert(T(std::forward<Args>(args)...));
+	}
+
+	const T &findMin() const
+	{
+		checkNotEmpty("findMin()");
+		return _items[0];
+	}
+
+	const T &findMax() const
+	{
+		checkNotEmpty("findMax()");
+		return _items[_maxSlot];
+	}
+
+	T popMin()
+	{
+		checkNotEmpty("popMin()");
+		return removeAt(0);
+	}
+
+	T popMax()
+	{
+		checkNotEmpty("popMax()");
+		return removeAt(_maxSlot);
+	}
+
+	bool empty() const
+	{
+		return _items.empty();
+	}
+
+	long unsigned int size() const
+	{
+		return _items.size();
+	}
+
+	long unsigned int capacity() const
+	{
+		return _capacity;
+	}
+
+	bool full() const
+	{
+		return _capacity != 0 && _items.size() >= _capacity;
+	}
+
+	/**
+	 *  Return heap data in level order; needs operator<< for T
+	 */
+	std::string to_string() const
+	{
+		std::ostringstream ret;
+		for (size_t i = 0; i < _items.size(); i++)
+		{
+			ret << _items[i] << " ";
+		}
+		return ret.str();
+	}
+};
+
+#endif
@@ -0,0 +1,175 @@
+//***************************************************************************//
+//**
+//**  MultiQueue: relaxed concurrent priority queue made of Heaps
+//**
+//***************************************************************************//
+
+#ifndef __MULTI_QUEUE_H
+#define __MULTI_QUEUE_H
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional> // std::less, std::hash
+#include <utility>	  // std::move
+#include "Heap.h"
+#include "AlignedAllocator.h"
+#include "../common/Workload.h"
+
+/**
+ *  Declaring MultiQueue class
+ *
+ *  A relaxed priority queue for many threads (Rihani, Sanders and Dementiev, "MultiQueues",
+ *   2015): numThreads * shardsPerThread sequential Heaps, each behind its own lock.
+ *  push() locks one random shard. pop() locks two random shards and takes the better of their
+ *   two tops. Locks are only ever taken with try_lock, and a busy shard just means another
+ *   random pick (or, in tryPop()'s final sweep, another pass), so no thread ever blocks on a
+ *   mutex held by another.
+ *  The price is relaxed order: pop() returns an element near the top, not necessarily the top.
+ *   The expected rank error grows linearly with the number of shards.
+ *  tryPop() returns false only after one sweep that locked every shard found them all empty.
+ */
+template <typename T, unsigned int Arity = 4, typename Compare = std::less<T>>
+class MultiQueue
+{
+private:
+	// padded so that two shards never share a cache line: locking one does not slow down its neighbours
+	struct Shard
+	{
+		std::mutex lock;
+		Heap<T, Arity, Compare> heap;
+		char padding[CACHE_LINE_BYTES];
+	};
+
+	std::vector<Shard, AlignedAllocator<Shard>> _shards;
+	std::atomic<long long> _size;
+	Compare _compare;
+
+	// each thread picks shards with its own generator
+	static WorkloadRng &threadRng()
+	{
+		thread_local WorkloadRng rng(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		return rng;
+	}
+
+	size_t randomShard()
+	{
+		return threadRng().below(_shards.size());
+	}
+
+public:
+	explicit MultiQueue(unsigned int numThreads = std::thread::hardware_concurrency(), unsigned int shardsPerThread = 2,
+						const Compare &compare = Compare())
+		: _shards(numThreads * shardsPerThread < 2 ? 2 : numThreads * shardsPerThread), _size(0), _compare(compare)
+	{
+	}
+
+	void push(T item)
+	{
+		while (true)
+		{
+			Shard &shard = _shards[randomShard()];
+			if (shard.lock.try_lock())
+			{
+				shard.heap.push(std::move(item));
+				_size++;
+				shard.lock.unlock();
+				return;
+			}
+		}
+	}
+
+	/**
+	 *  Removes an element close to the top into item; false if the queue was empty
+	 */
+	bool tryPop(T &item)
+	{
+		// random pairs first; if they keep coming up busy or empty, the queue is nearly drained
+		for (size_t attempt = 0; attempt < 2 * _shards.size(); ++attempt)
+		{
+			size_t i = randomShard();
+			size_t j = randomShard();
+			if (i == j || !_shards[i].lock.try_lock())
+			{
+				continue;
+			}
+			if (!_shards[j].lock.try_lock())
+			{
+				_shards[i].lock.unlock();
+				continue;
+			}
+			Heap<T, Arity, Compare> &a = _shards[i].heap;
+			Heap<T, Arity, Compare> &b = _shards[j].heap;
+			Heap<T, Arity, Compare> *best = nullptr;
+			if (!a.empty() && (b.empty() || !_compare(b.top(), a.top())))
+			{
+				best = &a;
+			}
+			else if (!b.empty())
+			{
+				best = &b;
+			}
+			if (best != nullptr)
+			{
+				item = best->pop();
+				_size--;
+			}
+			_shards[j].lock.unlock();
+			_shards[i].lock.unlock();
+			if (best != nullptr)
+			{
+				return true;
+			}
+		}
+
+		// sweep every shard; a busy one may hold the last elements, so sweep again until none was busy
+		while (true)
+		{
+			bool skipped = false;
+			for (size_t i = 0; i < _shards.size(); ++i)
+			{
+				if (!_shards[i].lock.try_lock())
+				{
+					skipped = true;
+					continue;
+				}
+				bool found = !_shards[i].heap.empty();
+				if (found)
+				{
+					item = _shards[i].heap.pop();
+					_size--;
+				}
+				_shards[i].lock.unlock();
+				if (found)
+				{
+					return true;
+				}
+			}
+			if (!skipped)
+			{
+				return false;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 *  Number of elements; only exact while no other thread is pushing or popping
+	 */
+	long unsigned int size() const
+	{
+		return _size.load();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	long unsigned int numShards() const
+	{
+		return _shards.size();
+	}
+};
+
+#endif
@@ -0,0 +1,199 @@
+//***************************************************************************//
+//**
+//**  Radix heap for monotone integer priorities
+//**
+//***************************************************************************//
+
+#ifndef __RADIX_HEAP_H
+#define __RADIX_HEAP_H
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>   // std::out_of_range, std::invalid_argument
+#include <type_traits> // std::make_unsigned
+#include <utility>	   // std::pair, std::move, std::forward
+#include <limits>
+
+/**
+ *  Key extraction for RadixHeap: an integer item is its own key, a std::pair is keyed by .first.
+ *  Keys are used as unsigned, so signed keys must not be negative.
+ */
+template <typename T>
+struct RadixKey
+{
+	typedef typename std::make_unsigned<T>::type key_type;
+	key_type operator()(const T &item) const { return static_cast<key_type>(item); }
+};
+
+template <typename First, typename Second>
+struct RadixKey<std::pair<First, Second>>
+{
+	typedef typename std::make_unsigned<First>::type key_type;
+	key_type operator()(const std::pair<First, Second> &item) const { return static_cast<key_type>(item.first); }
+};
+
+/**
+ *  Declaring RadixHeap class
+ *
+ *  A min-priority queue for monotone integer keys (Ahuja, Mehlhorn, Orlin and Tarjan, 1990): every
+ *   pushed key must be at least lastKey(), the last popped key, as with event timestamps or Dijkstra
+ *   distances. (top() may raise lastKey() to the current minimum key.)
+ *  An item with key k sits in bucket bitLength(k xor last), where last is the last popped key; bucket
+ *   0 holds items equal to last. pop() takes from bucket 0; when that is empty it finds the lowest
+ *   non-empty bucket, makes its minimum the new last and spreads the bucket over the lower buckets.
+ *   An item only moves to lower buckets, so push/pop cost amortized O(log C) for keys within C of
+ *   last, and the work per item is a xor, a count-leading-zeros and a vector append, not a
+ *   comparison chain.
+ *  Same interface as Heap (push, emplace, top, pop, empty, size, to_string); the order among items
+ *   with equal keys is unspecified.
+ */
+template <typename T, typename KeyOf = RadixKey<T>>
+class RadixHeap
+{
+public:
+	typedef T value_type;
+	typedef typename KeyOf::key_type Key;
+
+private:
+	static const int KEY_BITS = std::numeric_limits<Key>::digits;
+
+	// top() may have to refill bucket 0, which does not change the contents
+	mutable std::vector<T> _buckets[KEY_BITS + 1];
+	mutable Key _last;
+	long unsigned int _size;
+	KeyOf _keyOf;
+
+	static int bitLength(Key x)
+	{
+		return (x == 0) ? 0 : static_cast<int>(sizeof(unsigned long long) * 8) - __builtin_clzll(static_cast<unsigned long long>(x));
+	}
+
+	int bucketOf(const T &item) const
+	{
+		return bitLength(_keyOf(item) ^ _last);
+	}
+
+	void insert(T &&item)
+	{
+		if (_keyOf(item) < _last)
+		{
+			throw std::invalid_argument("push() - key below lastKey()");
+		}
+		_buckets[bucketOf(item)].push_back(std::move(item));
+		_size++;
+	}
+
+	// make bucket 0 non-empty; the heap must not be empty
+	void refill() const
+	{
+		if (!_buckets[0].empty())
+		{
+			return;
+		}
+		int i = 1;
+		while (_buckets[i].empty())
+		{
+			++i;
+		}
+		std::vector<T> &from = _buckets[i];
+		Key newLast = _keyOf(from[0]);
+		for (size_t k = 1; k < from.size(); ++k)
+		{
+			Key key = _keyOf(from[k]);
+			newLast = (key < newLast) ? key : newLast;
+		}
+		_last = newLast;
+		for (size_t k = 0; k < from.size(); ++k)
+		{
+			_buckets[bucketOf(from[k])].push_back(std::move(from[k]));
+		}
+		from.clear();
+	}
+
+public:
+	explicit RadixHeap(const KeyOf &keyOf = KeyOf()) : _last(0), _size(0), _keyOf(keyOf)
+	{
+	}
+
+	/**
+	 *  Adds a new item; its key must not be below lastKey()
+	 */
+	void push(const T &item)
+	{
+		T copy(item);
+		insert(std::move(copy));
+	}
+
+	void push(T &&item)
+	{
+		insert(std::move(item));
+	}
+
+	template <typename... Args>
+	void emplace(Args &&...args)
+	{
+		insert(T(std::forward<Args>(args)...));
+	}
+
+	const T &top() const
+	{
+		if (empty())
+		{
+			throw std::out_of_range("top() - No elements in heap");
+		}
+		refill();
+		return _buckets[0].back();
+	}
+
+	/**
+	 *  Removes an item with the minimum key and moves it out
+	 */
+	T pop()
+	{
+		if (empty())
+		{
+			throw std::out_of_range("pop() - No elements in heap");
+		}
+		refill();
+		T minItem = std::move(_buckets[0].back());
+		_buckets[0].pop_back();
+		_size--;
+		return minItem;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	long unsigned int size() const
+	{
+		return _size;
+	}
+
+	/**
+	 *  The lower bound for future pushes: the last popped key, or the top key once top() was called
+	 */
+	Key lastKey() const
+	{
+		return _last;
+	}
+
+	/**
+	 *  Return heap data bucket by bucket; needs operator<< for T
+	 */
+	std::string to_string() const
+	{
+		std::ostringstream ret;
+		for (int i = 0; i <= KEY_BITS; i++)
+		{
+			for (size_t k = 0; k < _buckets[i].size(); k++)
+			{
+				ret << _buckets[i][k] << " ";
+			}
+		}
+		return ret.str();
+	}
+};
+
+#endif
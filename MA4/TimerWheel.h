@@ -0,0 +1,270 @@
+//***************************************************************************//
+//**
+//**  Hierarchical timer wheel: O(1) schedule and cancel
+//**
+//***************************************************************************//
+
+#ifndef __TIMER_WHEEL_H
+#define __TIMER_WHEEL_H
+#include <vector>
+#include <cstdint>
+#include <stdexcept> // std::invalid_argument
+#include <utility>	 // std::move
+
+/**
+ *  Declaring TimerWheel class
+ *
+ *  A hierarchical timing wheel (Varghese and Lauck, 1987) for timeouts that are mostly cancelled
+ *   before they fire. Time is a 64-bit tick count. Level L has 64 slots, one per value of bits
+ *   6L .. 6L+5 of a deadline, and a timer sits on the level of the highest 6-bit group in which its
+ *   deadline differs from now(), as RadixHeap places keys by their highest bit differing from the
+ *   last key.
+ *  schedule() and cancel() are O(1): an append to a slot, and a swap-remove through the timer's
+ *   position in its slot as in IndexedHeap. advance() fires the timers of level 0 slot by slot;
+ *   when now() reaches a slot on a higher level, that slot cascades, its timers moving down to the
+ *   levels they now belong on. A timer cascades at most once per level, and a cancelled one never
+ *   does. A 64-bit occupancy mask per level lets advance() jump over empty slots, so the cost of
+ *   advance() does not grow with the length of the interval.
+ *  Timers fire in deadline order; timers with equal deadlines fire in unspecified order.
+ */
+template <typename T>
+class TimerWheel
+{
+public:
+	typedef T value_type;
+	typedef uint64_t TimerId; // generation << 32 | node index, so a stale id cancels nothing
+
+private:
+	static const int SLOT_BITS = 6;
+	static const unsigned int SLOTS = 1 << SLOT_BITS;
+	static const int LEVELS = (64 + SLOT_BITS - 1) / SLOT_BITS;
+	static const uint32_t FREE = static_cast<uint32_t>(-1);
+	static const size_t PREFETCH_AHEAD = 8; // nodes of a slot are scattered; fetch them ahead of use
+
+	struct Node
+	{
+		uint64_t deadline;
+		uint32_t slot;	   // level * SLOTS + slot on that level, or FREE
+		uint32_t position; // index in _slots[slot]
+		uint32_t generation;
+		T payload;
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<uint32_t> _free; // unused node indices
+	std::vector<uint32_t> _slots[LEVELS * SLOTS];
+	uint64_t _occupied[LEVELS]; // bit s: slot s of the level is non-empty
+	uint64_t _now;
+	long unsigned int _size;
+
+	static unsigned int digit(uint64_t time, int level)
+	{
+		return (time >> (SLOT_BITS * level)) & (SLOTS - 1);
+	}
+
+	// first tick of the level-sized block holding time; blocks of the top level cover all of time
+	static uint64_t blockStart(uint64_t time, int level)
+	{
+		int bits = SLOT_BITS * level;
+		return (bits >= 64) ? 0 : (time >> bits) << bits;
+	}
+
+	void place(uint32_t index)
+	{
+		Node &node = _nodes[index];
+		uint64_t differ = node.deadline ^ _now;
+		int level = (differ == 0) ? 0 : (63 - __builtin_clzll(differ)) / SLOT_BITS;
+		unsigned int s = digit(node.deadline, level);
+		node.slot = level * SLOTS + s;
+		node.position = _slots[node.slot].size();
+		_slots[node.slot].push_back(index);
+		_occupied[level] |= 1ULL << s;
+	}
+
+	void release(uint32_t index)
+	{
+		_nodes[index].slot = FREE;
+		_nodes[index].generation++;
+		_free.push_back(index);
+		_size--;
+	}
+
+	void clearIfEmpty(uint32_t slot)
+	{
+		if (_slots[slot].empty())
+		{
+			_occupied[slot / SLOTS] &= ~(1ULL << (slot % SLOTS));
+		}
+	}
+
+	// fire every timer in level 0 slot s, all of which are due at now()
+	long unsigned int expire(unsigned int s, std::vector<T> &expired)
+	{
+		std::vector<uint32_t> &due = _slots[s];
+		long unsigned int count = due.size();
+		for (size_t i = 0; i < due.size(); ++i)
+		{
+			if (i + PREFETCH_AHEAD < due.size())
+			{
+				__builtin_prefetch(&_nodes[due[i + PREFETCH_AHEAD]], 1);
+			}
+			expired.push_back(std::move(_nodes[due[i]].payload));
+			_nodes[due[i]].payload = T();
+			release(due[i]);
+		}
+		due.clear();
+		clearIfEmpty(s);
+		return count;
+	}
+
+	// move the timers of a higher level slot that now() has reached down to their new levels
+	void cascade(uint32_t slot)
+	{
+		std::vector<uint32_t> moving;
+		moving.swap(_slots[slot]);
+		clearIfEmpty(slot);
+		for (size_t i = 0; i < moving.size(); ++i)
+		{
+			if (i + PREFETCH_AHEAD < moving.size())
+			{
+				__builtin_prefetch(&_nodes[moving[i + PREFETCH_AHEAD]], 1);
+			}
+			place(moving[i]);
+		}
+		moving.clear();
+		_slots[slot].swap(moving); // keep the capacity; nothing was placed back into this slot
+	}
+
+public:
+	/**
+	 *  Empty wheel whose clock starts at now
+	 */
+	explicit TimerWheel(uint64_t now = 0) : _now(now), _size(0)
+	{
+		for (int level = 0; level < LEVELS; ++level)
+		{
+			_occupied[level] = 0;
+		}
+	}
+
+	/**
+	 *  Arms a timer that fires with payload once the clock reaches deadline; a deadline already
+	 *   past fires at the next advance(). Returns the id for cancel().
+	 */
+	TimerId schedule(uint64_t deadline, T payload)
+	{
+		uint32_t index;
+		if (_free.empty())
+		{
+			index = _nodes.size();
+			_nodes.push_back(Node());
+			_nodes[index].generation = 0;
+		}
+		else
+		{
+			index = _free.back();
+			_free.pop_back();
+		}
+		Node &node = _nodes[index];
+		node.deadline = (deadline < _now) ? _now : deadline;
+		node.payload = std::move(payload);
+		place(index);
+		_size++;
+		return (static_cast<TimerId>(node.generation) << 32) | index;
+	}
+
+	/**
+	 *  Disarms a timer; false if it already fired or was cancelled
+	 */
+	bool cancel(TimerId id)
+	{
+		if (!contains(id))
+		{
+			return false;
+		}
+		uint32_t index = static_cast<uint32_t>(id);
+		Node &node = _nodes[index];
+		std::vector<uint32_t> &slot = _slots[node.slot];
+		uint32_t moved = slot.back();
+		slot[node.position] = moved; // Move last timer of the slot into the hole
+		_nodes[moved].position = node.position;
+		slot.pop_back();
+		clearIfEmpty(node.slot);
+		node.payload = T();
+		release(index);
+		return true;
+	}
+
+	bool contains(TimerId id) const
+	{
+		uint32_t index = static_cast<uint32_t>(id);
+		return index < _nodes.size() && _nodes[index].slot != FREE && _nodes[index].generation == (id >> 32);
+	}
+
+	/**
+	 *  Moves the clock to time and appends the payloads of all timers due by then to expired, in
+	 *   deadline order. Returns the number of timers fired.
+	 */
+	long unsigned int advance(uint64_t time, std::vector<T> &expired)
+	{
+		if (time < _now)
+		{
+			throw std::invalid_argument("advance() - time cannot go backwards");
+		}
+		long unsigned int fired = 0;
+		while (true)
+		{
+			fired += expire(digit(_now, 0), expired);
+
+			// the next slot to reach is on the lowest level with an occupied slot after now(): every
+			// slot of a level lies in the current block of the level above, before that level's slots
+			int level = 0;
+			uint64_t later = 0;
+			for (; level < LEVELS; ++level)
+			{
+				unsigned int d = digit(_now, level);
+				later = (d + 1 == SLOTS) ? 0 : _occupied[level] & (~0ULL << (d + 1));
+				if (later != 0)
+				{
+					break;
+				}
+			}
+			if (level == LEVELS)
+			{
+				_now = time;
+				return fired;
+			}
+			uint64_t next = blockStart(_now, level + 1) | (static_cast<uint64_t>(__builtin_ctzll(later)) << (SLOT_BITS * level));
+			if (next > time)
+			{
+				_now = time;
+				return fired;
+			}
+			_now = next;
+			if (level > 0)
+			{
+				cascade(level * SLOTS + digit(_now, level));
+			}
+		}
+	}
+
+	uint64_t now() const
+	{
+		return _now;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	/**
+	 *  Number of armed timers
+	 */
+	long unsigned int size() const
+	{
+		return _size;
+	}
+};
+
+#endif
@@ -0,0 +1,262 @@
+//***************************************************************************//
+//**
+//**  Parallel top-k selection with bounded Heaps
+//**
+//***************************************************************************//
+
+#ifndef __TOP_K_H
+#define __TOP_K_H
+#include <vector>
+#include <stdexcept>  // std::invalid_argument
+#include <functional> // std::greater, std::less
+#include <algorithm>  // std::min, std::reverse
+#include "Heap.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOP_K_X86 1
+#endif
+
+/**
+ *  Prefilter kernels: the scalar loop, or AVX2 compares of 16 elements against the threshold at a
+ *   time. topK() falls back to the scalar loop for element types without a vector kernel.
+ */
+enum TopKKernel
+{
+	TOP_K_SCALAR_KERNEL,
+	TOP_K_AVX2_KERNEL
+};
+
+inline bool topKKernelSupported(TopKKernel kernel)
+{
+#ifdef TOP_K_X86
+	if (kernel == TOP_K_AVX2_KERNEL)
+	{
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	return kernel == TOP_K_SCALAR_KERNEL;
+}
+
+inline TopKKernel topKBestKernel()
+{
+	return topKKernelSupported(TOP_K_AVX2_KERNEL) ? TOP_K_AVX2_KERNEL : TOP_K_SCALAR_KERNEL;
+}
+
+inline const char *topKKernelName(TopKKernel kernel)
+{
+	return (kernel == TOP_K_AVX2_KERNEL) ? "AVX2" : "scalar";
+}
+
+#ifdef TOP_K_X86
+// first 16-element block from i with an element beyond threshold (greater, or less if !Greater);
+// returns end rounded down to a block if there is none, the scalar loop finishes from there
+template <bool Greater>
+__attribute__((target("avx2")))
+inline size_t skipBlocksAvx2(const int *data, size_t i, size_t end, int threshold)
+{
+	__m256i t = _mm256_set1_epi32(threshold);
+	for (; i + 16 <= end; i += 16)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 8));
+		__m256i hit = Greater ? _mm256_or_si256(_mm256_cmpgt_epi32(a, t), _mm256_cmpgt_epi32(b, t))
+							  : _mm256_or_si256(_mm256_cmpgt_epi32(t, a), _mm256_cmpgt_epi32(t, b));
+		if (!_mm256_testz_si256(hit, hit))
+		{
+			break;
+		}
+	}
+	return i;
+}
+
+template <bool Greater>
+__attribute__((target("avx2")))
+inline size_t skipBlocksAvx2(const float *data, size_t i, size_t end, float threshold)
+{
+	__m256 t = _mm256_set1_ps(threshold);
+	for (; i + 16 <= end; i += 16)
+	{
+		__m256 a = _mm256_loadu_ps(data + i);
+		__m256 b = _mm256_loadu_ps(data + i + 8);
+		__m256 hit = Greater ? _mm256_or_ps(_mm256_cmp_ps(a, t, _CMP_GT_OQ), _mm256_cmp_ps(b, t, _CMP_GT_OQ))
+							 : _mm256_or_ps(_mm256_cmp_ps(a, t, _CMP_LT_OQ), _mm256_cmp_ps(b, t, _CMP_LT_OQ));
+		if (_mm256_movemask_ps(hit) != 0)
+		{
+			break;
+		}
+	}
+	return i;
+}
+#endif
+
+/**
+ *  Vector prefilter for one element type and order; the primary template has none
+ */
+template <typename T, typename Compare>
+struct TopKPrefilter
+{
+	static size_t skipBlocks(const T *, size_t i, size_t, const T &) { return i; }
+};
+
+#ifdef TOP_K_X86
+template <typename T, bool Greater>
+struct TopKAvx2Prefilter
+{
+	static size_t skipBlocks(const T *data, size_t i, size_t end, const T &threshold)
+	{
+		return skipBlocksAvx2<Greater>(data, i, end, threshold);
+	}
+};
+
+template <>
+struct TopKPrefilter<int, std::greater<int>> : TopKAvx2Prefilter<int, true>
+{
+};
+template <>
+struct TopKPrefilter<int, std::less<int>> : TopKAvx2Prefilter<int, false>
+{
+};
+template <>
+struct TopKPrefilter<float, std::greater<float>> : TopKAvx2Prefilter<float, true>
+{
+};
+template <>
+struct TopKPrefilter<float, std::less<float>> : TopKAvx2Prefilter<float, false>
+{
+};
+#endif
+
+// reversed order: the top of a Heap under it is the worst item kept
+template <typename T, typename Compare>
+struct TopKWorse
+{
+	Compare better;
+	explicit TopKWorse(const Compare &b) : better(b) {}
+	bool operator()(const T &a, const T &b) const { return better(b, a); }
+};
+
+// one sorted run of the merge; the merge heap's top is the run with the best head
+template <typename T>
+struct TopKCursor
+{
+	const T *at;
+	const T *end;
+};
+
+template <typename T, typename Compare>
+struct TopKHeadBetter
+{
+	Compare better;
+	explicit TopKHeadBetter(const Compare &b) : better(b) {}
+	bool operator()(const TopKCursor<T> &a, const TopKCursor<T> &b) const { return better(*a.at, *b.at); }
+};
+
+/**
+ *  The k best of data[lo, hi) into run, best first. A Heap of the first k items under the reversed
+ *   order keeps the worst of them on top as the threshold; an item that beats it replaces the top.
+ *   On random input few items do once the Heap has warmed up, so nearly all the time goes into the
+ *   prefilter scan for the next item that does.
+ */
+template <typename T, typename Compare>
+void topKChunk(const T *data, size_t lo, size_t hi, size_t k, const Compare &better, TopKKernel kernel, std::vector<T> &run)
+{
+	size_t fill = std::min(k, hi - lo);
+	if (fill == 0)
+	{
+		return;
+	}
+	Heap<T, 4, TopKWorse<T, Compare>> kept(data + lo, data + lo + fill, TopKWorse<T, Compare>(better));
+	bool vectorScan = (kernel == TOP_K_AVX2_KERNEL);
+	for (size_t i = lo + fill;; ++i)
+	{
+		const T &threshold = kept.top();
+		// on random input about 16 k / (i - lo) blocks hold a hit; skip blocks only once most do not
+		if (vectorScan && i - lo >= 32 * fill)
+		{
+			i = TopKPrefilter<T, Compare>::skipBlocks(data, i, hi, threshold);
+		}
+		while (i < hi && !better(data[i], threshold))
+		{
+			++i;
+		}
+		if (i == hi)
+		{
+			break;
+		}
+		kept.replace_top(data[i]);
+	}
+	run.reserve(kept.size());
+	while (!kept.empty())
+	{
+		run.push_back(kept.pop());
+	}
+	std::reverse(run.begin(), run.end());
+}
+
+/**
+ *  The k best items of data[0, n) under better (by default the k largest), sorted best first;
+ *   all n of them if n <= k. Ties between equal items are broken arbitrarily.
+ *
+ *  Each OpenMP thread selects the k best of its own contiguous chunk with a bounded Heap, then
+ *   the per-thread runs are merged by a k-way merge that stops after k items. The scan of each
+ *   chunk skips whole blocks of items that do not beat the current threshold with the given
+ *   prefilter kernel, which needs int or float items under std::greater or std::less; other
+ *   types scan with the scalar loop.
+ *  Work is O(n + p k log k) for p threads on random input and O(n log k) at worst (ascending input
+ *   when selecting the largest).
+ */
+template <typename T, typename Compare = std::greater<T>>
+std::vector<T> topK(const T *data, size_t n, size_t k, const Compare &better = Compare(), TopKKernel kernel = topKBestKernel())
+{
+	if (!topKKernelSupported(kernel))
+	{
+		throw std::invalid_argument("topK() - kernel not supported on this CPU");
+	}
+	static const size_t PARALLEL_MIN = 1 << 16; // smaller inputs are scanned by one thread
+
+	std::vector<std::vector<T>> runs;
+#ifdef _OPENMP
+	runs.resize(omp_get_max_threads());
+#pragma omp parallel if (n >= PARALLEL_MIN)
+	{
+		size_t p = omp_get_num_threads();
+		size_t t = omp_get_thread_num();
+		topKChunk(data, n * t / p, n * (t + 1) / p, k, better, kernel, runs[t]);
+	}
+#else
+	runs.resize(1);
+	topKChunk(data, 0, n, k, better, kernel, runs[0]);
+#endif
+
+	Heap<TopKCursor<T>, 2, TopKHeadBetter<T, Compare>> heads((TopKHeadBetter<T, Compare>(better)));
+	for (size_t t = 0; t < runs.size(); ++t)
+	{
+		if (!runs[t].empty())
+		{
+			TopKCursor<T> cursor = {runs[t].data(), runs[t].data() + runs[t].size()};
+			heads.push(cursor);
+		}
+	}
+	std::vector<T> best;
+	best.reserve(std::min(k, n));
+	while (best.size() < k && !heads.empty())
+	{
+		TopKCursor<T> cursor = heads.top();
+		best.push_back(*cursor.at);
+		if (++cursor.at != cursor.end)
+		{
+			heads.replace_top(cursor);
+		}
+		else
+		{
+			heads.pop();
+		}
+	}
+	return best;
+}
+
+#endif
@@ -1,5 +1,16 @@
 #include "OpenMP.h"
 #include "Heap.h"
+#include "IndexedHeap.h"
+#include "MultiQueue.h"
+#include "RadixHeap.h"
+#include "MinMaxHeap.h"
+#include "TopK.h"
+#include "TimerWheel.h"
+#include "BHeap.h"
+#include "HeapBenchmark.h"
+#include <memory>
+#include <set>
+#include <thread>
 
 void runOpenMP()
 {
@@ -8,7 +19,9 @@ void runOpenMP()
     calMax();
 }
 
-void runHeap()
+// any heap with Heap's interface and a min-heap order on int keys
+template <typename HeapType>
+void runHeap(const char *name)
 {
     int data_size = 10000;
     int *data = new int[data_size];
@@ -16,7 +29,7 @@ void runHeap()
     {
         data[i] = rand() % data_size;
     }
-    auto *hp = new Heap<int>();
+    auto *hp = new HeapType();
     for (int i = 0; i < data_size; ++i)
     {
         hp->push(data[i]);
@@ -32,12 +45,433 @@ void runHeap()
         // If the two required functions are correct, the assertion should pass
         assert(vect[i] == hp->pop());
     }
-    std::cout<< "(3) Test runHeap() assert pass!" << std::endl;
+    std::cout<< "(3) Test runHeap(" << name << ") assert pass!" << std::endl;
+    delete hp;
+    delete[] data;
+}
+
+template <unsigned int Arity>
+void runHeapify()
+{
+    int data_size = 3000000; // above the parallel heapify threshold
+    std::vector<int> data(data_size);
+    for (int i = 0; i < data_size; ++i)
+    {
+        data[i] = rand() % data_size;
+    }
+    std::vector<int> vect(data);
+    std::sort(vect.begin(), vect.end());
+
+    // range constructor, then a small and a large push_range on top of it
+    int head = data_size / 2;
+    Heap<int, Arity> hp(data.begin(), data.begin() + head);
+    hp.push_range(data.begin() + head, data.begin() + head + 10);
+    hp.push_range(data.begin() + head + 10, data.end());
+    for (int i = 0; i < data_size; ++i)
+    {
+        assert(vect[i] == hp.pop());
+    }
+
+    Heap<int, Arity> moved(std::move(data));
+    for (int i = 0; i < data_size; ++i)
+    {
+        assert(vect[i] == moved.pop());
+    }
+    std::cout<< "(4) Test runHeapify<" << Arity << ">() assert pass!" << std::endl;
+}
+
+// a move-only element ordered by a custom comparator
+struct Job
+{
+    std::unique_ptr<int> deadline;
+    std::string name;
+
+    Job(int d, const std::string &n) : deadline(new int(d)), name(n) {}
+};
+
+struct LaterDeadlineFirst
+{
+    bool operator()(const Job &a, const Job &b) const { return *a.deadline > *b.deadline; }
+};
+
+void runGenericHeap()
+{
+    Heap<Job, 4, LaterDeadlineFirst> jobs;
+    int data_size = 1000;
+    for (int i = 0; i < data_size; ++i)
+    {
+        jobs.emplace((i * 7919) % data_size, "job" + std::to_string(i));
+    }
+    for (int i = data_size - 1; i >= 0; --i)
+    {
+        Job job = jobs.pop();
+        assert(*job.deadline == i);
+    }
+    assert(jobs.empty());
+    std::cout<< "(5) Test runGenericHeap() assert pass!" << std::endl;
+}
+
+// random push/update/erase/pop against a std::set of (priority, handle) pairs
+void runIndexedHeap()
+{
+    int numHandles = 2000;
+    IndexedHeap<int, 4> hp(numHandles / 2); // the position map has to grow for the upper half
+    std::set<std::pair<int, size_t>> reference;
+    std::vector<int> current(numHandles, -1);
+    for (int step = 0; step < 200000; ++step)
+    {
+        size_t h = rand() % numHandles;
+        int p = rand() % 1000;
+        int op = rand() % 4;
+        if (current[h] < 0)
+        {
+            hp.push(h, p);
+            reference.insert(std::make_pair(p, h));
+            current[h] = p;
+        }
+        else if (op == 0)
+        {
+            hp.erase(h);
+            reference.erase(std::make_pair(current[h], h));
+            current[h] = -1;
+        }
+        else if (op == 1)
+        {
+            hp.update(h, p);
+            reference.erase(std::make_pair(current[h], h));
+            reference.insert(std::make_pair(p, h));
+            current[h] = p;
+        }
+        else if (op == 2)
+        {
+            std::pair<size_t, int> top = hp.pop();
+            assert(top.second == reference.begin()->first);
+            reference.erase(std::make_pair(top.second, top.first));
+            current[top.first] = -1;
+        }
+        assert(hp.size() == reference.size());
+        assert(hp.empty() || hp.topPriority() == reference.begin()->first);
+    }
+    std::cout<< "(6) Test runIndexedHeap() assert pass!" << std::endl;
+}
+
+// threads push and pop concurrently, then drain; every value must come out exactly once
+void runMultiQueue()
+{
+    const int numThreads = 4;
+    const int perThread = 50000;
+    MultiQueue<int> queue(numThreads);
+    std::vector<std::vector<int>> popped(numThreads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; ++t)
+    {
+        workers.push_back(std::thread([&, t]() {
+            int item;
+            for (int i = 0; i < perThread; ++i)
+            {
+                queue.push(t * perThread + i);
+                if (i % 2 == 1 && queue.tryPop(item))
+                {
+                    popped[t].push_back(item);
+                }
+            }
+        }));
+    }
+    for (int t = 0; t < numThreads; ++t)
+    {
+        workers[t].join();
+    }
+    int item;
+    while (queue.tryPop(item))
+    {
+        popped[0].push_back(item);
+    }
+    assert(queue.empty());
+
+    std::vector<int> all;
+    for (int t = 0; t < numThreads; ++t)
+    {
+        all.insert(all.end(), popped[t].begin(), popped[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    assert((int)all.size() == numThreads * perThread);
+    for (int i = 0; i < numThreads * perThread; ++i)
+    {
+        assert(all[i] == i);
+    }
+    std::cout<< "(7) Test runMultiQueue() assert pass!" << std::endl;
+}
+
+// event-simulation style interleaving: pop the earliest time, push a later one; the radix heap must
+// pop the same keys as Heap, and reject a key below the last popped one
+void runRadixHeap()
+{
+    RadixHeap<std::pair<unsigned long long, int>> radix;
+    Heap<unsigned long long> reference;
+    for (int i = 0; i < 1000; ++i)
+    {
+        unsigned long long t = rand() % 100000;
+        radix.emplace(t, i);
+        reference.push(t);
+    }
+    for (int step = 0; step < 200000; ++step)
+    {
+        std::pair<unsigned long long, int> event = radix.pop();
+        assert(event.first == reference.pop());
+        unsigned long long next = event.first + (step % 3 == 0 ? 0 : rand() % (1 << (step % 40 < 20 ? 8 : 30)));
+        radix.emplace(next, event.second);
+        reference.push(next);
+    }
+    bool rejected = false;
+    try
+    {
+        radix.push(std::make_pair(radix.lastKey() - 1, 0));
+    }
+    catch (const std::invalid_argument &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+    (void)rejected;
+    std::cout<< "(8) Test runRadixHeap() assert pass!" << std::endl;
+}
+
+// random pushes and pops at both ends against a std::multiset, then a bounded buffer against a sort
+void runMinMaxHeap()
+{
+    MinMaxHeap<int> hp;
+    std::multiset<int> reference;
+    for (int step = 0; step < 200000; ++step)
+    {
+        int op = rand() % 5;
+        if (op < 3 || reference.empty())
+        {
+            int x = rand() % 10000;
+            hp.push(x);
+            reference.insert(x);
+        }
+        else if (op == 3)
+        {
+            assert(hp.popMin() == *reference.begin());
+            reference.erase(reference.begin());
+        }
+        else
+        {
+            assert(hp.popMax() == *reference.rbegin());
+            reference.erase(std::prev(reference.end()));
+        }
+        assert(hp.size() == reference.size());
+        assert(hp.empty() || (hp.findMin() == *reference.begin() && hp.findMax() == *reference.rbegin()));
+    }
+
+    // keep the 100 largest of a stream
+    int data_size = 100000;
+    MinMaxHeap<int, std::greater<int>> best(100);
+    std::vector<int> data(data_size);
+    for (int i = 0; i < data_size; ++i)
+    {
+        data[i] = rand();
+        best.push(data[i]);
+        assert(best.size() <= 100);
+    }
+    std::sort(data.begin(), data.end(), std::greater<int>());
+    for (int i = 0; i < 100; ++i)
+    {
+        assert(best.popMin() == data[i]);
+    }
+    std::cout<< "(9) Test runMinMaxHeap() assert pass!" << std::endl;
+}
+
+void runTopK()
+{
+    // int and float with a vector prefilter under either order, strings without one;
+    // sizes on both sides of the parallel cutoff, k of 0, 1, mid-range and past n
+    long long sizes[] = {0, 5, 1000, 200003};
+    size_t ks[] = {0, 1, 17, 1000, 300000};
+    TopKKernel kernels[] = {TOP_K_SCALAR_KERNEL, TOP_K_AVX2_KERNEL};
+    for (long long n : sizes)
+    {
+        std::vector<int> data = generateKeys(n, 48, KeyWorkload(UNIFORM_KEYS, -1000000, 1000000));
+        std::vector<float> reals(data.begin(), data.end());
+        std::vector<int> descending(data);
+        std::sort(descending.begin(), descending.end(), std::greater<int>());
+        std::vector<int> ascending(descending.rbegin(), descending.rend());
+        for (size_t k : ks)
+        {
+            size_t m = std::min(k, (size_t)n);
+            std::vector<int> expectLargest(descending.begin(), descending.begin() + m);
+            std::vector<int> expectSmallest(ascending.begin(), ascending.begin() + m);
+            std::vector<float> expectReals(expectLargest.begin(), expectLargest.end());
+            for (TopKKernel kernel : kernels)
+            {
+                if (!topKKernelSupported(kernel))
+                {
+                    continue;
+                }
+                std::vector<int> largest = topK(data.data(), n, k, std::greater<int>(), kernel);
+                assert(largest == expectLargest);
+                std::vector<int> smallest = topK(data.data(), n, k, std::less<int>(), kernel);
+                assert(smallest == expectSmallest);
+                std::vector<float> largestReals = topK(reals.data(), n, k, std::greater<float>(), kernel);
+                assert(largestReals == expectReals);
+                // every item beats the threshold: the worst case, a heap update per item
+                std::vector<int> sortedInput = topK(ascending.data(), n, k, std::greater<int>(), kernel);
+                assert(sortedInput == largest);
+            }
+        }
+    }
+
+    std::vector<std::string> names = generateNames(5000, 6, 48);
+    std::vector<std::string> sortedNames(names);
+    std::sort(sortedNames.begin(), sortedNames.end());
+    std::vector<std::string> first = topK(names.data(), names.size(), 50, std::less<std::string>());
+    assert(first == std::vector<std::string>(sortedNames.begin(), sortedNames.begin() + 50));
+    std::cout<< "(10) Test runTopK() assert pass!" << std::endl;
+}
+
+void runTimerWheel()
+{
+    // random schedule / cancel / advance against a sorted set of (deadline, payload), with
+    // deadlines from next tick to 2^40 ticks out so timers start on every level and cascade
+    TimerWheel<int> wheel(1000);
+    std::set<std::pair<uint64_t, int>> reference;
+    std::vector<TimerWheel<int>::TimerId> ids;
+    std::vector<uint64_t> deadlines;
+    std::vector<int> fired;
+    WorkloadRng rng(49);
+    for (int step = 0; step < 200000; ++step)
+    {
+        int op = rng.below(10);
+        if (op < 5)
+        {
+            uint64_t now = wheel.now();
+            uint64_t deadline = now + rng.below(1ULL << rng.below(41));
+            if (op == 0)
+            {
+                deadline = now - rng.below(now + 1); // already due
+            }
+            int payload = ids.size();
+            ids.push_back(wheel.schedule(deadline, payload));
+            deadlines.push_back(std::max(deadline, now));
+            reference.insert(std::make_pair(deadlines.back(), payload));
+        }
+        else if (op < 8 && !ids.empty())
+        {
+            // also cancels timers that already fired or were cancelled, whose ids must be stale
+            int j = rng.below(ids.size());
+            bool armed = reference.erase(std::make_pair(deadlines[j], j)) > 0;
+            assert(wheel.contains(ids[j]) == armed);
+            assert(wheel.cancel(ids[j]) == armed);
+            (void)armed;
+        }
+        else
+        {
+            uint64_t to = wheel.now() + rng.below(1ULL << rng.below(30));
+            fired.clear();
+            long unsigned int count = wheel.advance(to, fired);
+            assert(count == fired.size() && wheel.now() == to);
+            (void)count;
+            for (size_t i = 0; i < fired.size(); ++i)
+            {
+                assert(deadlines[fired[i]] <= to);
+                assert(i == 0 || deadlines[fired[i - 1]] <= deadlines[fired[i]]);
+                assert(reference.erase(std::make_pair(deadlines[fired[i]], fired[i])) == 1);
+            }
+            assert(reference.empty() || reference.begin()->first > to);
+        }
+        assert(wheel.size() == reference.size());
+    }
+    std::cout<< "(11) Test runTimerWheel() assert pass!" << std::endl;
+}
+
+// interleaved push / pop against a multiset; pages of 16 bytes make the page boundaries frequent
+template <typename HeapType>
+void runBHeapOrder(const char *name)
+{
+    HeapType hp;
+    std::multiset<int> reference;
+    for (int step = 0; step < 300000; ++step)
+    {
+        if (rand() % 5 < 3 || reference.empty())
+        {
+            int x = rand();
+            hp.push(x);
+            reference.insert(x);
+        }
+        else
+        {
+            assert(hp.top() == *reference.begin());
+            assert(hp.pop() == *reference.begin());
+            reference.erase(reference.begin());
+        }
+        assert(hp.size() == reference.size());
+    }
+    while (!reference.empty())
+    {
+        assert(hp.pop() == *reference.begin());
+        reference.erase(reference.begin());
+    }
+    assert(hp.empty());
+    std::cout<< "(12) Test runBHeap(" << name << ") assert pass!" << std::endl;
+}
+
+void runBHeap()
+{
+    runBHeapOrder<BHeap<int>>("BHeap<int>");
+    runBHeapOrder<BHeap<int, std::less<int>, 64>>("BHeap<int, less, 64>");
+    runBHeapOrder<BHeap<int, std::less<int>, 16>>("BHeap<int, less, 16>");
+
+    // non-trivial items, max order
+    std::vector<std::string> names = generateNames(20000, 5, 50);
+    BHeap<std::string, std::greater<std::string>, 256> hp;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        hp.emplace(names[i]);
+    }
+    std::sort(names.begin(), names.end(), std::greater<std::string>());
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        assert(hp.pop() == names[i]);
+    }
+    std::cout<< "(12) Test runBHeap() assert pass!" << std::endl;
 }
 
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "bench")
+    {
+        // MA4 bench [maxSize]: push/pop/hold throughput of binary, 4-ary and 8-ary heaps, 10^3 .. maxSize elements
+        long long maxSize = (argc > 2) ? (long long)atof(argv[2]) : 10000000;
+        runHeapBenchmark(maxSize);
+        runPayloadBenchmark(100000, 1024);
+        runHeapifyBenchmark(maxSize);
+        runDijkstraBenchmark(1000000, 8);
+        runDijkstraBenchmark(100000, 64);
+        runMultiQueueQuality(1000000);
+        runMultiQueueScaling(2000000);
+        runRadixHeapBenchmark(maxSize);
+        runTopKBenchmark(100000000);
+        runParallelTopKBenchmark(1000000000);
+        runTimerBenchmark(100000, 100);
+        runBHeapBenchmark(maxSize);
+        return 0;
+    }
     std::cout << "Running" << std::endl;
     runOpenMP();
-    runHeap();
+    runHeap<Heap<int, 2>>("Heap<int, 2>");
+    runHeap<Heap<int, 4>>("Heap<int, 4>");
+    runHeap<Heap<int, 8>>("Heap<int, 8>");
+    runHeap<RadixHeap<int>>("RadixHeap<int>");
+    runHeap<BHeap<int>>("BHeap<int>");
+    runHeapify<2>();
+    runHeapify<4>();
+    runHeapify<8>();
+    runGenericHeap();
+    runIndexedHeap();
+    runMultiQueue();
+    runRadixHeap();
+    runMinMaxHeap();
+    runTopK();
+    runTimerWheel();
+    runBHeap();
 }
\ No newline at end of file
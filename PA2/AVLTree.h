@@ -6,22 +6,41 @@
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <string>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "EytzingerTree.h"
+#include "TreeAggregates.h"
+#include "TreeInstrumentation.h"
+#include "BalancePolicies.h"
+#include "TreeSerialization.h"
 
 using namespace std;
 
-template <typename Comparable>
+// Aggregate is an optional policy from TreeAggregates.h (sum, min, max, count, ...) enabling rangeAggregate();
+// Instrumentation is a policy from TreeInstrumentation.h that observes comparisons and rebalancing;
+// Balance picks the rebalancing scheme from BalancePolicies.h (AVL by default, or WAVL / red-black)
+template <typename Comparable, typename Aggregate = NoAggregate, typename Instrumentation = NoInstrumentation, typename Balance = AVLBalance>
 class AVLTree
 {
 private:
-    struct AVLNode  // refer to textbook, Figure 4.40
+    struct AVLNode : AggregateField<Aggregate>  // refer to textbook, Figure 4.40
     {
         Comparable element;
         AVLNode *left;
         AVLNode *right;
-        int height;
+        AVLNode *parent;    // lets iterators step to the in-order successor without a stack
+        int height;         // the rank under the balancing policy; for AVL exactly the height
 
-        AVLNode( const Comparable & theElement, AVLNode *lt, AVLNode *rt ): element(theElement), left(lt), right(rt) {}
-        AVLNode( Comparable && theElement, AVLNode *lt, AVLNode *rt ): element(move(theElement)), left(lt), right(rt) {}
+        AVLNode( const Comparable & theElement, AVLNode *lt, AVLNode *rt, AVLNode *pt = nullptr ): element(theElement), left(lt), right(rt), parent(pt), height(0) {}
+        AVLNode( Comparable && theElement, AVLNode *lt, AVLNode *rt, AVLNode *pt = nullptr ): element(move(theElement)), left(lt), right(rt), parent(pt), height(0) {}
     };
 
     AVLNode *root;
@@ -30,16 +49,104 @@ private:
     AVLNode * findMax( AVLNode * t ) const;
     void makeEmpty( AVLNode * & t );
 
+    static int height(AVLNode * t);
+    static void update(AVLNode * t);
+
+    AVLNode * lowerBound(const Comparable & x) const;
+    AVLNode * upperBound(const Comparable & x) const;
+    template <typename Visitor>
+    void rangeVisit(AVLNode * t, const Comparable & lo, const Comparable & hi, Visitor & visit) const;
+
+    typename Aggregate::value_type aggregateAbove(AVLNode * t, const Comparable & lo) const;
+    typename Aggregate::value_type aggregateBelow(AVLNode * t, const Comparable & hi) const;
+
+    template <typename Arg>
+    AVLNode * insert(Arg && x, AVLNode * & y, AVLNode * parent, bool & inserted, bool assign);
+
     void balance(AVLNode * & t);
     void rotateWithLeftChild( AVLNode * & t );
     void rotateWithRightChild( AVLNode * & t );
     void doubleWithLeftChild( AVLNode * & t);
     void doubleWithRightChild( AVLNode * & t);
 
+    // join/split on raw subtrees, following Blelloch, Ferizovic and Sun, "Just Join for Parallel Ordered Sets"
+    AVLNode * link(AVLNode * l, AVLNode * k, AVLNode * r);
+    AVLNode * join(AVLNode * l, AVLNode * k, AVLNode * r);
+    AVLNode * joinRight(AVLNode * l, AVLNode * k, AVLNode * r);
+    AVLNode * joinLeft(AVLNode * l, AVLNode * k, AVLNode * r);
+    AVLNode * join2(AVLNode * l, AVLNode * r);
+    AVLNode * split(AVLNode * t, const Comparable & x, AVLNode * & l, AVLNode * & r);
+    AVLNode * splitLast(AVLNode * t, AVLNode * & rest);
+
+    AVLNode * unionWith(AVLNode * t1, AVLNode * t2);
+    AVLNode * intersectWith(AVLNode * t1, AVLNode * t2);
+    AVLNode * differenceWith(AVLNode * t1, AVLNode * t2);
+
 public:
+    // bidirectional in-order iterator; ++/-- follow parent pointers, amortized O(1)
+    class const_iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Comparable value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Comparable * pointer;
+        typedef const Comparable & reference;
+
+        const_iterator() : current(nullptr), tree(nullptr) {}
+
+        const Comparable & operator*() const { return current->element; }
+        const Comparable * operator->() const { return &current->element; }
+
+        const_iterator & operator++();
+        const_iterator operator++(int) { const_iterator old = *this; ++(*this); return old; }
+        const_iterator & operator--();
+        const_iterator operator--(int) { const_iterator old = *this; --(*this); return old; }
+
+        bool operator==(const const_iterator & rhs) const { return current == rhs.current; }
+        bool operator!=(const const_iterator & rhs) const { return current != rhs.current; }
+
+    private:
+        const AVLNode *current;    // nullptr means end()
+        const AVLTree *tree;       // needed so that --end() can find the maximum
+
+        const_iterator(const AVLNode *p, const AVLTree *t) : current(p), tree(t) {}
+        friend class AVLTree;
+    };
+    typedef const_iterator iterator;   // elements are keys, so they are never modified in place
+
     AVLTree();
     ~AVLTree();
 
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator find(const Comparable & x) const;
+    const_iterator lower_bound(const Comparable & x) const;   // first element >= x
+    const_iterator upper_bound(const Comparable & x) const;   // first element >  x
+
+    // calls visit(element) for every element in [lo, hi] in ascending order, O(log n + k)
+    template <typename Visitor>
+    void rangeVisit(const Comparable & lo, const Comparable & hi, Visitor visit) const;
+
+    // only with an Aggregate policy: the combination of the elements in [lo, hi] in ascending order,
+    // from O(log n) cached subtree aggregates; identity() for an empty range
+    typename Aggregate::value_type rangeAggregate(const Comparable & lo, const Comparable & hi) const;
+    typename Aggregate::value_type aggregate() const;
+
+    // checkpointing: the in-order sequence in the compact binary format of TreeSerialization.h.
+    // Loading replaces the contents with a tree built straight from the sorted sequence in O(n),
+    // with no comparisons beyond an order check and no rotations. Errors throw runtime_error.
+    void save(ostream & out) const;
+    void save(const string & path) const;
+    void load(istream & in);
+    void load(const string & path);
+    void loadMapped(const string & path);   // mmap the file and decode in place, for very large files
+
+    // immutable, array-based copy of the current contents for read-mostly use
+    EytzingerTree<Comparable> freeze() const;
+
+    static size_t nodeBytes() { return sizeof(AVLNode); }
+
     void makeEmpty();
     const Comparable & findMin() const;
     const Comparable & findMax() const;
@@ -47,8 +154,16 @@ public:
     bool contains(const Comparable & x) const;
     bool contains( const Comparable & x, AVLNode* y ) const;
 
-    void insert(const Comparable & x);
-    void insert(const Comparable & x, AVLNode* & y);
+    // insert x if it is not already present, in a single root-to-leaf walk;
+    // returns the position of x and whether it was inserted
+    pair<const_iterator, bool> insert(const Comparable & x);
+    pair<const_iterator, bool> insert(Comparable && x);
+    template <typename... Args>
+    pair<const_iterator, bool> emplace(Args &&... args);
+    // upsert: like insert, but an equivalent element already in the tree is overwritten with x
+    // (for map-like elements whose operator< only looks at the key)
+    pair<const_iterator, bool> insertOrAssign(const Comparable & x);
+    pair<const_iterator, bool> insertOrAssign(Comparable && x);
 
     void remove(const Comparable & x);
     void remove( const Comparable & x, AVLNode* & y );
@@ -59,45 +174,115 @@ public:
     int computeHeight() const;
     int computeHeight(AVLNode* t) const;
 
-    int readRootHeight() const;
+    int readRootHeight() const;   // the cached rank of the root; the height itself under AVL balancing
 
     bool isBalanced() const;
     bool isBalanced(AVLNode* t) const;
     
     bool isBST() const;
-    bool isBST(AVLNode* t, Comparable min, Comparable max) const;
+    bool isBST(AVLNode* t, const Comparable * lo, const Comparable * hi) const;   // nullptr bound = unbounded
 
     double averageDepth() const;
-    void averageDepth(AVLNode* t, int depth, int &totalDepth, int &nodeCount) const;
+    void averageDepth(AVLNode* t, int depth, long long &totalDepth, long long &nodeCount) const;
+
+    // one O(n) pass over the whole tree checking strict order, parent links, cached heights and the
+    // AVL balance condition; on failure *reason (if given) names the first violated invariant
+    bool validate(const char ** reason = nullptr) const;
+
+    // rotations done by rebalancing, per kind of update, as counted by the Instrumentation policy;
+    // all zero for NoInstrumentation
+    struct OperationStats
+    {
+        long long calls;
+        long long singleRotations;
+        long long doubleRotations;
+        OperationStats() : calls(0), singleRotations(0), doubleRotations(0) {}
+    };
+
+    // shape and cost summary, gathered in one O(n) pass
+    struct Stats
+    {
+        long long nodes;
+        int height;
+        long long totalDepth;
+        double averageDepth;
+        vector<long long> depthHistogram;   // depthHistogram[d] = number of nodes at depth d
+        size_t nodeBytes;
+        size_t memoryBytes;                 // nodes * nodeBytes, without allocator overhead
+        OperationStats inserts;
+        OperationStats removes;
+    };
+    Stats stats() const;
+    void printStats(ostream & out) const;
+
+    // the instrumentation policy object, e.g. for CountingInstrumentation::snapshot() and reset()
+    const Instrumentation & counters() const { return instrumentation; }
+    Instrumentation & counters() { return instrumentation; }
 
 
     void removeByRank(int rank);
     void removeByRank(AVLNode* & t, int rank, int &count);
 
+    // bulk operations; the trees passed in are emptied and their nodes are moved into the result.
+    // They rebalance with AVL heights, so they only compile for the default AVLBalance.
+    void join(AVLTree & lt, const Comparable & k, AVLTree & rt);    // requires lt < k < rt
+    bool split(const Comparable & k, AVLTree & lt, AVLTree & rt);   // lt gets < k, rt gets > k; true if k was found
+
+    // this = this op other, with the two halves of each split run as OpenMP tasks
+    void unionWith(AVLTree & other);
+    void intersectWith(AVLTree & other);
+    void differenceWith(AVLTree & other);
+
     // the next line follows textbook Figure 4.42, Line 19
     static const int ALLOWED_IMBALANCE = 1;
+
+    // subtrees shorter than this are combined sequentially instead of spawning tasks
+    static const int PARALLEL_CUTOFF_HEIGHT = 12;
+
+private:
+    mutable Instrumentation instrumentation;   // mutable so that const lookups can be observed
+
+    bool less(const Comparable & a, const Comparable & b) const { instrumentation.comparison(); return a < b; }
+
+    // the balancing policy drives rotations and rank changes through these
+    friend Balance;
+    void countRotation(bool isDouble) { instrumentation.rotation(isDouble); instrumentation.rebalanceStep(); }
+    void countRebalanceStep() { instrumentation.rebalanceStep(); }
+
+    template <typename Arg>
+    pair<const_iterator, bool> insertFromRoot(Arg && x, bool assign);
+
+    template <typename Reader>
+    void loadFrom(Reader & r);
+    template <typename Reader>
+    AVLNode * buildFromSorted(Reader & r, size_t n, uint64_t & codecState, const Comparable * & last);
+
+    int checkedHeight(AVLNode * t) const;
+    int validate(AVLNode * t, AVLNode * parent, const Comparable * lo, const Comparable * hi, const char * & reason) const;
+    void collectStats(AVLNode * t, int depth, Stats & s) const;
+    OperationStats operationStats(TreeOperation op) const;
 };
 
 // constructor
-template <class Comparable>
-AVLTree<Comparable>::AVLTree() : root(NULL) {}
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLTree() : root(NULL) {}
 
 // destructor
-template <class Comparable>
-AVLTree<Comparable>::~AVLTree()
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+AVLTree<Comparable, Aggregate, Instrumentation, Balance>::~AVLTree()
 {
     makeEmpty();
 }
 
 // public makeEmpty: follow the makeEmpty in BST, referring to textbook, Figure 4.27
-template <typename Comparable>
-void AVLTree<Comparable>::makeEmpty() {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::makeEmpty() {
     makeEmpty(root);
 }
 
 // private recursive makeEmpty: follow the makeEmpty in BST, referring to textbook, Figure 4.27
-template <typename Comparable>
-void AVLTree<Comparable>::makeEmpty(AVLNode * & t) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::makeEmpty(AVLNode * & t) {
     if ( t != NULL ) {
         makeEmpty(t->left);
         makeEmpty(t->right);
@@ -107,8 +292,8 @@ void AVLTree<Comparable>::makeEmpty(AVLNode * & t) {
 }
 
 // public findMin: follow the findMin in BST, referring to textbook, Figure 4.20
-template <typename Comparable>
-const Comparable & AVLTree<Comparable>::findMin() const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+const Comparable & AVLTree<Comparable, Aggregate, Instrumentation, Balance>::findMin() const {
     
     if (root == NULL) {
         throw underflow_error("Tree is empty");
@@ -117,8 +302,8 @@ const Comparable & AVLTree<Comparable>::findMin() const {
 }
 
 // private findMin: follow the findMin in BST, referring to textbook, Figure 4.20
-template <typename Comparable>
-typename AVLTree<Comparable>::AVLNode* AVLTree<Comparable>::findMin(AVLNode * t) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::findMin(AVLNode * t) const {
 
     if ( t == NULL ) {
         return NULL;
@@ -130,8 +315,8 @@ typename AVLTree<Comparable>::AVLNode* AVLTree<Comparable>::findMin(AVLNode * t)
 }
 
 // public findMax: follow the findMax in BST, referring to textbook, Figure 4.21
-template <typename Comparable>
-const Comparable & AVLTree<Comparable>::findMax() const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+const Comparable & AVLTree<Comparable, Aggregate, Instrumentation, Balance>::findMax() const {
 
     if (root == NULL) {
         throw underflow_error("Tree is empty");
@@ -140,8 +325,8 @@ const Comparable & AVLTree<Comparable>::findMax() const {
 }
 
 // private findMax: follow the findMax in BST, referring to textbook, Figure 4.21
-template <typename Comparable>
-typename AVLTree<Comparable>::AVLNode* AVLTree<Comparable>::findMax(AVLNode * t) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::findMax(AVLNode * t) const {
 
     if ( t == NULL ) {
         return NULL;
@@ -154,22 +339,25 @@ typename AVLTree<Comparable>::AVLNode* AVLTree<Comparable>::findMax(AVLNode * t)
 
 // start our implementation:
 // public contains: follow the contains in BST, referring to textbook, Figure 4.17 and Figure 4.18
-template<typename Comparable>
-bool AVLTree<Comparable>::contains( const Comparable & x ) const {
-    return contains(x, root);
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::contains( const Comparable & x ) const {
+    instrumentation.beginOperation(LOOKUP_OPERATION);
+    bool found = contains(x, root);
+    instrumentation.endOperation();
+    return found;
 }
 
 // private contains
-template<typename Comparable>
-bool AVLTree<Comparable>::contains( const Comparable & x, AVLNode* y ) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::contains( const Comparable & x, AVLNode* y ) const {
 
     if (y == nullptr) 
     {
         return false;
-    } else if (x < y->element) 
+    } else if (less(x, y->element)) 
     {
         return contains(x, y->left); 
-    } else if (y->element < x) 
+    } else if (less(y->element, x)) 
     {
         return contains(x, y->right); 
     } else 
@@ -180,45 +368,97 @@ bool AVLTree<Comparable>::contains( const Comparable & x, AVLNode* y ) const {
 }
 
 // public insert: following BST, referring to textbook, Figure 4.17 and Figure 4.23
-template<typename Comparable>
-void AVLTree<Comparable>::insert(const Comparable & x) {
-    insert(x, root);
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insert(const Comparable & x) {
+    return insertFromRoot(x, false);
+}
+
+// public insert: moves x into the new node instead of copying it
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insert(Comparable && x) {
+    return insertFromRoot(move(x), false);
+}
+
+// public emplace: the element has to exist before it can be compared, so build it once and move it in
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename... Args>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::emplace(Args &&... args) {
+    return insert(Comparable(std::forward<Args>(args)...));
+}
+
+// public insertOrAssign
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insertOrAssign(const Comparable & x) {
+    return insertFromRoot(x, true);
+}
+
+// public insertOrAssign
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insertOrAssign(Comparable && x) {
+    return insertFromRoot(move(x), true);
+}
+
+// private insertFromRoot: bookkeeping shared by the public insert overloads
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Arg>
+pair<typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator, bool> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insertFromRoot(Arg && x, bool assign) {
+    bool inserted;
+    instrumentation.beginOperation(INSERT_OPERATION);
+    AVLNode *t = insert(std::forward<Arg>(x), root, nullptr, inserted, assign);
+    instrumentation.endOperation();
+    return make_pair(const_iterator(t, this), inserted);
 }
 
-// private insert
-template<typename Comparable>
-void AVLTree<Comparable>::insert(const Comparable & x, AVLNode* & y) {
+// private insert: returns the node holding x. Rotations relink nodes but never move elements
+// between them, so the returned node stays valid while the recursion rebalances on the way up.
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Arg>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::insert(Arg && x, AVLNode* & y, AVLNode* parent, bool & inserted, bool assign) {
+    AVLNode *result;
     if ( y == nullptr) 
     {
-        y  = new AVLNode(x, nullptr, nullptr);
-    } else if (x < y->element) 
+        y  = new AVLNode(std::forward<Arg>(x), nullptr, nullptr, parent);
+        update(y);
+        inserted = true;
+        return y;
+    } else if (less(x, y->element)) 
     {
-        insert(x, y->left); 
-    } else if (y->element < x) 
+        result = insert(std::forward<Arg>(x), y->left, y, inserted, assign); 
+    } else if (less(y->element, x)) 
     {
-        insert(x, y->right); 
+        result = insert(std::forward<Arg>(x), y->right, y, inserted, assign); 
     } else 
     {
-        return;  // Handles case of duplicates implicitly
+        inserted = false;  // duplicate: nothing changed below, so no rebalancing either
+        if (assign) {
+            y->element = std::forward<Arg>(x);
+            update(y);
+        }
+        return y;
+    }
+    if (inserted || assign) {   // an assignment changes no heights, but it may change the aggregates above
+        Balance::afterInsert(*this, y);
     }
-    balance(y);
+    return result;
 }
 
 // public remove: refer to textbook, Figure 4.17 and Figure 4.26
-template<typename Comparable>
-void AVLTree<Comparable>::remove( const Comparable & x ) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::remove( const Comparable & x ) {
+    instrumentation.beginOperation(REMOVE_OPERATION);
     remove(x, root);
+    instrumentation.endOperation();
 }
 
 // private remove
-template<typename Comparable>
-void AVLTree<Comparable>::remove( const Comparable & x, AVLNode* & y ) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::remove( const Comparable & x, AVLNode* & y ) {
     if (y == nullptr) {
         return;
     }
-    if (x < y->element) {
+    if (less(x, y->element)) {
         remove(x, y->left); 
-    } else if (y->element < x) {
+    } else if (less(y->element, x)) {
         remove(x, y->right); 
     } else { 
         if (y->left && y->right) { 
@@ -227,122 +467,179 @@ void AVLTree<Comparable>::remove( const Comparable & x, AVLNode* & y ) {
         } else {
             AVLNode* oldNode = y; 
             y = (y->left != nullptr) ? y->left : y->right; 
+            if (y != nullptr) {
+                y->parent = oldNode->parent;
+            }
             delete oldNode; 
         }
     }
-    balance(y);
+    Balance::afterRemove(*this, y);
+}
+
+// private height: cached height of a subtree, -1 for an empty one
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::height(AVLNode * t) {
+    return (t == nullptr) ? -1 : t->height;
+}
+
+// private update: recompute the cached height (and aggregate, if any) of t from its children.
+// Every structural change funnels through here, so rotations, join and split keep aggregates right.
+// Ranks of the other balancing policies are not a function of the children; the policy sets them.
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::update(AVLNode * t) {
+    if (Balance::RANK_IS_HEIGHT) {
+        t->height = 1 + max(height(t->left), height(t->right));
+    }
+    AVLNode::pull(t);
 }
 
 // private balance: refer to textbook, Figure 4.42, Line 21 - 40
 // assume t is the node that violates the AVL condition, and we then identify which case to use (out of 4 cases)
-template<typename Comparable>
-void AVLTree<Comparable>::balance(AVLNode * & t) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::balance(AVLNode * & t) {
 if (t == nullptr) {
         return;
     }
 
-    // Update the height of the current node
-    t->height = 1 + max(computeHeight(t->left), computeHeight(t->right));
-    
-    int imbalance = computeHeight(t->left) - computeHeight(t->right);
+    int imbalance = height(t->left) - height(t->right);
+    int oldHeight = t->height;
 
     // Left heavy
-    if (imbalance > 1) {
-        if (computeHeight(t->left->left) >= computeHeight(t->left->right)) {
+    if (imbalance > ALLOWED_IMBALANCE) {
+        if (height(t->left->left) >= height(t->left->right)) {
             rotateWithLeftChild(t);
+            countRotation(false);
         } else {
             doubleWithLeftChild(t);
+            countRotation(true);
         }
     }
     // Right heavy
-    else if (imbalance < -1) {
-        if (computeHeight(t->right->right) >= computeHeight(t->right->left)) {
+    else if (imbalance < -ALLOWED_IMBALANCE) {
+        if (height(t->right->right) >= height(t->right->left)) {
             rotateWithRightChild(t);
+            countRotation(false);
         } else {
             doubleWithRightChild(t);
+            countRotation(true);
         }
     }
+
+    // Update the height of the current node
+    update(t);
+
+    // rebalancing has propagated to this level if it had to rotate (counted there) or its height changed
+    if (oldHeight != t->height && imbalance <= ALLOWED_IMBALANCE && imbalance >= -ALLOWED_IMBALANCE) {
+        countRebalanceStep();
+    }
 }
 
 // private rotateWithLeftChild: for case 1, referring to textbook, Figure 4.44 (code) and Figure 4.43 (visualization)
-template<typename Comparable>
-void AVLTree<Comparable>::rotateWithLeftChild(AVLNode * & k2) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::rotateWithLeftChild(AVLNode * & k2) {
     AVLNode* k1 = k2->left;
     k2->left = k1->right;
+    if (k2->left != nullptr) {
+        k2->left->parent = k2;
+    }
     k1->right = k2;
-    k2->height = max(computeHeight(k2->left), computeHeight(k2->right)) +1; 
-    k1->height = max(computeHeight(k1->left), k2->height) +1;
+    k1->parent = k2->parent;
+    k2->parent = k1;
+    update(k2);
+    update(k1);
     k2 = k1;
 }
 
 // private rotateWithRightChild: for case 4 (the mirrored case of case 1)
-template<typename Comparable>
-void AVLTree<Comparable>::rotateWithRightChild(AVLNode * & k2) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::rotateWithRightChild(AVLNode * & k2) {
     AVLNode* k1 = k2->right;
     k2->right = k1->left;
+    if (k2->right != nullptr) {
+        k2->right->parent = k2;
+    }
     k1->left = k2;
-    k2->height = max(computeHeight(k2->left), computeHeight(k2->right)) +1; 
-    k1->height = max(computeHeight(k1->right), k2->height) +1;
+    k1->parent = k2->parent;
+    k2->parent = k1;
+    update(k2);
+    update(k1);
     k2 = k1;
 }
 
 // private doubleWithLeftChild: for case 2, see textbook, Figure 4.46 (code) and Figure 4.45 (visualization)
-template<typename Comparable>
-void AVLTree<Comparable>::doubleWithLeftChild(AVLNode * & k3) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::doubleWithLeftChild(AVLNode * & k3) {
     rotateWithRightChild(k3->left);
     rotateWithLeftChild(k3);
 }
 
 // private doubleWithRightChild: for case 3 (the mirrored case of case 2)
-template<typename Comparable>
-void AVLTree<Comparable>::doubleWithRightChild(AVLNode * & k3) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::doubleWithRightChild(AVLNode * & k3) {
     rotateWithLeftChild(k3->right);
     rotateWithRightChild(k3);
 }
 
 // public isBalanced
-template <class Comparable>
-bool AVLTree<Comparable>::isBalanced() const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::isBalanced() const {
+    if (!Balance::RANK_IS_HEIGHT) {
+        return validate();   // "balanced" means the rank rule of the policy, not the AVL condition
+    }
     return isBalanced(root);
 }
 
 // private isBalanced
-template <class Comparable>
-bool AVLTree<Comparable>::isBalanced(AVLNode* t) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::isBalanced(AVLNode* t) const {
+    return checkedHeight(t) != -2;
+}
+
+// private checkedHeight: the true height of t (ignoring the cache), or -2 as soon as some subtree is
+// out of balance, so every node is visited once instead of once per ancestor
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::checkedHeight(AVLNode * t) const {
     if (t == nullptr) {
-        return true;
+        return -1;
+    }
+    int hl = checkedHeight(t->left);
+    if (hl == -2) {
+        return -2;
     }
-    return (abs(computeHeight(t->left) - computeHeight(t->right)) <= 1) && isBalanced(t->left) && isBalanced(t->right);
+    int hr = checkedHeight(t->right);
+    if (hr == -2 || abs(hl - hr) > ALLOWED_IMBALANCE) {
+        return -2;
+    }
+    return 1 + max(hl, hr);
 }
 
 // public isBST
-template <class Comparable>
-bool AVLTree<Comparable>::isBST() const {
-    return isBST(root, numeric_limits<Comparable>::min(), numeric_limits<Comparable>::max());
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::isBST() const {
+    return isBST(root, nullptr, nullptr);
 }
 
-// private isBST
-template<typename Comparable>
-bool AVLTree<Comparable>::isBST(AVLNode* t, Comparable min, Comparable max) const {
+// private isBST: bounds are the nearest ancestors on either side, so only operator< is needed
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::isBST(AVLNode* t, const Comparable * lo, const Comparable * hi) const {
     if (t == nullptr){
         return true;
     }
-    if (t->element < min || t->element > max) {
+    if ((lo != nullptr && t->element < *lo) || (hi != nullptr && *hi < t->element)) {
         return false;
     }
-    return isBST(t->left, min, t->element) && isBST(t->right, t->element, max);
+    return isBST(t->left, lo, &t->element) && isBST(t->right, &t->element, hi);
 }
 
 // public treeSize
-template <typename Comparable>
-int AVLTree<Comparable>::treeSize() const {
-    treeSize(root);
-    return 0;
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::treeSize() const {
+    return treeSize(root);
 }
 
 // private treeSize
-template <typename Comparable>
-int AVLTree<Comparable>::treeSize(AVLNode* t) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::treeSize(AVLNode* t) const {
     if (t == nullptr) {
         return 0;
     }
@@ -350,14 +647,14 @@ int AVLTree<Comparable>::treeSize(AVLNode* t) const {
 }
 
 // public computeHeight. See Figure 4.61 in Textbook
-template <typename Comparable>
-int AVLTree<Comparable>::computeHeight() const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::computeHeight() const {
     return computeHeight(root);
 }
 
 // private computeHeight
-template <typename Comparable>
-int AVLTree<Comparable>::computeHeight(AVLNode* t) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::computeHeight(AVLNode* t) const {
     if (t == nullptr) {
         return -1;
     }
@@ -365,8 +662,8 @@ int AVLTree<Comparable>::computeHeight(AVLNode* t) const {
 }
 
 // public readRootHeight
-template <typename Comparable>
-int AVLTree<Comparable>::readRootHeight() const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::readRootHeight() const {
     if (root == nullptr) {
         return -1;
     }
@@ -375,10 +672,10 @@ int AVLTree<Comparable>::readRootHeight() const {
 }
 
 // public averageDepth
-template <typename Comparable>
-double AVLTree<Comparable>::averageDepth() const {
-    int total = 0;
-    int nodes = 0;
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+double AVLTree<Comparable, Aggregate, Instrumentation, Balance>::averageDepth() const {
+    long long total = 0;
+    long long nodes = 0;
     averageDepth(root, 0, total, nodes);
 
     // static cast line adapted from information in https://www.daniweb.com/programming/software-development/threads/128202/issues-with-static-cast-double
@@ -386,8 +683,8 @@ double AVLTree<Comparable>::averageDepth() const {
 }
 
 // private averageDepth
-template <typename Comparable>
-void AVLTree<Comparable>::averageDepth(AVLNode* t, int depth, int &total, int &nodes) const {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::averageDepth(AVLNode* t, int depth, long long &total, long long &nodes) const {
     if (t == nullptr) {
         return;
     }
@@ -397,16 +694,112 @@ void AVLTree<Comparable>::averageDepth(AVLNode* t, int depth, int &total, int &n
     averageDepth(t->right, depth + 1, total, nodes);
 }
 
+// public validate
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::validate(const char ** reason) const {
+    const char *why = nullptr;
+    if (root != nullptr && root->parent != nullptr) {
+        why = "root has a parent";
+    } else {
+        validate(root, nullptr, nullptr, nullptr, why);
+    }
+    if (reason != nullptr) {
+        *reason = why;
+    }
+    return why == nullptr;
+}
+
+// private validate: returns the true height of t; stops descending once reason is set.
+// The rank rule of the balancing policy is checked once both subtrees are known to be valid.
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+int AVLTree<Comparable, Aggregate, Instrumentation, Balance>::validate(AVLNode * t, AVLNode * parent, const Comparable * lo, const Comparable * hi, const char * & reason) const {
+    if (t == nullptr || reason != nullptr) {
+        return -1;
+    }
+    if (t->parent != parent) {
+        reason = "parent pointer does not match";
+    } else if ((lo != nullptr && !(*lo < t->element)) || (hi != nullptr && !(t->element < *hi))) {
+        reason = "elements out of order";
+    }
+    int hl = validate(t->left, t, lo, &t->element, reason);
+    int hr = validate(t->right, t, &t->element, hi, reason);
+    if (reason == nullptr) {
+        reason = Balance::check(t);
+    }
+    return 1 + max(hl, hr);
+}
+
+// public stats
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::Stats AVLTree<Comparable, Aggregate, Instrumentation, Balance>::stats() const {
+    Stats s;
+    s.nodes = 0;
+    s.totalDepth = 0;
+    collectStats(root, 0, s);
+    s.height = static_cast<int>(s.depthHistogram.size()) - 1;
+    s.averageDepth = (s.nodes > 0) ? static_cast<double>(s.totalDepth) / s.nodes : 0.0;
+    s.nodeBytes = nodeBytes();
+    s.memoryBytes = s.nodes * s.nodeBytes;
+    s.inserts = operationStats(INSERT_OPERATION);
+    s.removes = operationStats(REMOVE_OPERATION);
+    return s;
+}
+
+// private operationStats
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::OperationStats AVLTree<Comparable, Aggregate, Instrumentation, Balance>::operationStats(TreeOperation op) const {
+    OperationCounters c = instrumentation.snapshot(op);
+    OperationStats s;
+    s.calls = c.operations;
+    s.singleRotations = c.singleRotations;
+    s.doubleRotations = c.doubleRotations;
+    return s;
+}
+
+// private collectStats
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::collectStats(AVLNode * t, int depth, Stats & s) const {
+    if (t == nullptr) {
+        return;
+    }
+    if (static_cast<int>(s.depthHistogram.size()) <= depth) {
+        s.depthHistogram.resize(depth + 1, 0);
+    }
+    s.depthHistogram[depth]++;
+    s.nodes++;
+    s.totalDepth += depth;
+    collectStats(t->left, depth + 1, s);
+    collectStats(t->right, depth + 1, s);
+}
+
+// public printStats
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::printStats(ostream & out) const {
+    Stats s = stats();
+    out << "nodes: " << s.nodes << ", height: " << s.height << ", average depth: " << s.averageDepth
+        << ", node memory: " << s.memoryBytes << " B (" << s.nodeBytes << " B/node)" << endl;
+    out << "depth histogram:";
+    for (size_t d = 0; d < s.depthHistogram.size(); d++) {
+        out << " " << d << ":" << s.depthHistogram[d];
+    }
+    out << endl;
+    if (!Instrumentation::COUNTS) {
+        return;
+    }
+    out << "inserts: " << s.inserts.calls << " (" << s.inserts.singleRotations << " single, " << s.inserts.doubleRotations << " double rotations)"
+        << "; removes: " << s.removes.calls << " (" << s.removes.singleRotations << " single, " << s.removes.doubleRotations << " double rotations)" << endl;
+}
+
 // public removeByRank
-template <typename Comparable>
-void AVLTree<Comparable>::removeByRank(int rank) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::removeByRank(int rank) {
     int count = 0;
     removeByRank(root, rank, count);
 }
 
 // private removeByBank
-template <typename Comparable>
-void AVLTree<Comparable>::removeByRank(AVLNode* & t, int rank, int &count) {
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::removeByRank(AVLNode* & t, int rank, int &count) {
     if (t == nullptr) {
         return;
     }
@@ -423,4 +816,636 @@ void AVLTree<Comparable>::removeByRank(AVLNode* & t, int rank, int &count) {
     }
 }
 
+// const_iterator ++: leftmost node of the right subtree, otherwise the first ancestor we reach from its left side
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator & AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator::operator++() {
+    if (current->right != nullptr) {
+        current = current->right;
+        while (current->left != nullptr) {
+            current = current->left;
+        }
+    } else {
+        const AVLNode *child = current;
+        current = current->parent;
+        while (current != nullptr && child == current->right) {
+            child = current;
+            current = current->parent;
+        }
+    }
+    return *this;
+}
+
+// const_iterator --: mirror of ++, where --end() is the maximum
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator & AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator::operator--() {
+    if (current == nullptr) {
+        current = tree->findMax(tree->root);
+    } else if (current->left != nullptr) {
+        current = current->left;
+        while (current->right != nullptr) {
+            current = current->right;
+        }
+    } else {
+        const AVLNode *child = current;
+        current = current->parent;
+        while (current != nullptr && child == current->left) {
+            child = current;
+            current = current->parent;
+        }
+    }
+    return *this;
+}
+
+// public begin
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator AVLTree<Comparable, Aggregate, Instrumentation, Balance>::begin() const {
+    return const_iterator(findMin(root), this);
+}
+
+// public end
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator AVLTree<Comparable, Aggregate, Instrumentation, Balance>::end() const {
+    return const_iterator(nullptr, this);
+}
+
+// public find
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator AVLTree<Comparable, Aggregate, Instrumentation, Balance>::find(const Comparable & x) const {
+    AVLNode *t = lowerBound(x);
+    if (t != nullptr && x < t->element) {
+        t = nullptr;
+    }
+    return const_iterator(t, this);
+}
+
+// public lower_bound
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator AVLTree<Comparable, Aggregate, Instrumentation, Balance>::lower_bound(const Comparable & x) const {
+    return const_iterator(lowerBound(x), this);
+}
+
+// public upper_bound
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::const_iterator AVLTree<Comparable, Aggregate, Instrumentation, Balance>::upper_bound(const Comparable & x) const {
+    return const_iterator(upperBound(x), this);
+}
+
+// private lowerBound: remember the last node where we went left, one root-to-leaf walk
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::lowerBound(const Comparable & x) const {
+    AVLNode *t = root;
+    AVLNode *result = nullptr;
+    while (t != nullptr) {
+        if (t->element < x) {
+            t = t->right;
+        } else {
+            result = t;
+            t = t->left;
+        }
+    }
+    return result;
+}
+
+// private upperBound
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::upperBound(const Comparable & x) const {
+    AVLNode *t = root;
+    AVLNode *result = nullptr;
+    while (t != nullptr) {
+        if (x < t->element) {
+            result = t;
+            t = t->left;
+        } else {
+            t = t->right;
+        }
+    }
+    return result;
+}
+
+// public rangeVisit
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Visitor>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::rangeVisit(const Comparable & lo, const Comparable & hi, Visitor visit) const {
+    rangeVisit(root, lo, hi, visit);
+}
+
+// private rangeVisit: in-order walk that skips subtrees lying entirely outside [lo, hi]
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Visitor>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::rangeVisit(AVLNode * t, const Comparable & lo, const Comparable & hi, Visitor & visit) const {
+    while (t != nullptr) {
+        if (t->element < lo) {
+            t = t->right;
+        } else if (hi < t->element) {
+            t = t->left;
+        } else {
+            rangeVisit(t->left, lo, hi, visit);
+            visit(t->element);
+            t = t->right;   // the right subtree is only bounded by hi now; loop instead of recursing
+        }
+    }
+}
+
+// public rangeAggregate: descend to the first node inside [lo, hi]; below it, the range is a suffix
+// of its left subtree plus a prefix of its right subtree
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename Aggregate::value_type AVLTree<Comparable, Aggregate, Instrumentation, Balance>::rangeAggregate(const Comparable & lo, const Comparable & hi) const {
+    AVLNode *t = root;
+    while (t != nullptr) {
+        if (t->element < lo) {
+            t = t->right;
+        } else if (hi < t->element) {
+            t = t->left;
+        } else {
+            typename Aggregate::value_type a = Aggregate::combine(aggregateAbove(t->left, lo), Aggregate::lift(t->element));
+            return Aggregate::combine(a, aggregateBelow(t->right, hi));
+        }
+    }
+    return Aggregate::identity();
+}
+
+// public aggregate
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename Aggregate::value_type AVLTree<Comparable, Aggregate, Instrumentation, Balance>::aggregate() const {
+    return (root == nullptr) ? Aggregate::identity() : root->agg;
+}
+
+// private aggregateAbove: the elements >= lo in t; each node we keep brings its whole right subtree along
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename Aggregate::value_type AVLTree<Comparable, Aggregate, Instrumentation, Balance>::aggregateAbove(AVLNode * t, const Comparable & lo) const {
+    typename Aggregate::value_type a = Aggregate::identity();
+    while (t != nullptr) {
+        if (t->element < lo) {
+            t = t->right;
+        } else {
+            typename Aggregate::value_type keep = Aggregate::lift(t->element);
+            if (t->right != nullptr) {
+                keep = Aggregate::combine(keep, t->right->agg);
+            }
+            a = Aggregate::combine(keep, a);   // deeper nodes are smaller, so they go in front
+            t = t->left;
+        }
+    }
+    return a;
+}
+
+// private aggregateBelow: mirror of aggregateAbove for the elements <= hi
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename Aggregate::value_type AVLTree<Comparable, Aggregate, Instrumentation, Balance>::aggregateBelow(AVLNode * t, const Comparable & hi) const {
+    typename Aggregate::value_type a = Aggregate::identity();
+    while (t != nullptr) {
+        if (hi < t->element) {
+            t = t->left;
+        } else {
+            typename Aggregate::value_type keep = Aggregate::lift(t->element);
+            if (t->left != nullptr) {
+                keep = Aggregate::combine(t->left->agg, keep);
+            }
+            a = Aggregate::combine(a, keep);
+            t = t->right;
+        }
+    }
+    return a;
+}
+
+// private link: make k the root over l and r, which must already be balanced against each other
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::link(AVLNode * l, AVLNode * k, AVLNode * r) {
+    k->left = l;
+    k->right = r;
+    k->parent = nullptr;
+    if (l != nullptr) {
+        l->parent = k;
+    }
+    if (r != nullptr) {
+        r->parent = k;
+    }
+    update(k);
+    return k;
+}
+
+// private join: every element of l < k->element < every element of r, O(|height(l) - height(r)|)
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::join(AVLNode * l, AVLNode * k, AVLNode * r) {
+    AVLNode *t;
+    if (height(l) > height(r) + ALLOWED_IMBALANCE) {
+        t = joinRight(l, k, r);
+    } else if (height(r) > height(l) + ALLOWED_IMBALANCE) {
+        t = joinLeft(l, k, r);
+    } else {
+        t = link(l, k, r);
+    }
+    t->parent = nullptr;
+    return t;
+}
+
+// private joinRight: walk down the right spine of the taller tree l until r fits, then rebalance on the way up
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::joinRight(AVLNode * l, AVLNode * k, AVLNode * r) {
+    AVLNode *c = l->right;
+    if (height(c) <= height(r) + ALLOWED_IMBALANCE) {
+        l->right = link(c, k, r);
+        l->right->parent = l;
+        if (height(l->right) > height(l->left) + ALLOWED_IMBALANCE) {
+            rotateWithLeftChild(l->right);
+            rotateWithRightChild(l);
+        } else {
+            update(l);
+        }
+    } else {
+        l->right = joinRight(c, k, r);
+        l->right->parent = l;
+        if (height(l->right) > height(l->left) + ALLOWED_IMBALANCE) {
+            rotateWithRightChild(l);
+        } else {
+            update(l);
+        }
+    }
+    return l;
+}
+
+// private joinLeft: mirror of joinRight for a taller r
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::joinLeft(AVLNode * l, AVLNode * k, AVLNode * r) {
+    AVLNode *c = r->left;
+    if (height(c) <= height(l) + ALLOWED_IMBALANCE) {
+        r->left = link(l, k, c);
+        r->left->parent = r;
+        if (height(r->left) > height(r->right) + ALLOWED_IMBALANCE) {
+            rotateWithRightChild(r->left);
+            rotateWithLeftChild(r);
+        } else {
+            update(r);
+        }
+    } else {
+        r->left = joinLeft(l, k, c);
+        r->left->parent = r;
+        if (height(r->left) > height(r->right) + ALLOWED_IMBALANCE) {
+            rotateWithLeftChild(r);
+        } else {
+            update(r);
+        }
+    }
+    return r;
+}
+
+// private join2: join without a middle element, borrowing the maximum of l
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::join2(AVLNode * l, AVLNode * r) {
+    if (l == nullptr) {
+        return r;
+    }
+    AVLNode *rest;
+    AVLNode *k = splitLast(l, rest);
+    return join(rest, k, r);
+}
+
+// private splitLast: detach the maximum node of t, rest receives the remaining tree
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::splitLast(AVLNode * t, AVLNode * & rest) {
+    if (t->right == nullptr) {
+        rest = t->left;
+        if (rest != nullptr) {
+            rest->parent = nullptr;
+        }
+        return t;
+    }
+    AVLNode *rightRest;
+    AVLNode *last = splitLast(t->right, rightRest);
+    rest = join(t->left, t, rightRest);
+    return last;
+}
+
+// private split: l receives the elements < x and r the elements > x;
+// returns the detached node holding x, or nullptr when x is absent
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::split(AVLNode * t, const Comparable & x, AVLNode * & l, AVLNode * & r) {
+    if (t == nullptr) {
+        l = r = nullptr;
+        return nullptr;
+    }
+    AVLNode *tl = t->left;
+    AVLNode *tr = t->right;
+    AVLNode *found;
+    if (x < t->element) {
+        AVLNode *rl;
+        found = split(tl, x, l, rl);
+        r = join(rl, t, tr);
+    } else if (t->element < x) {
+        AVLNode *lr;
+        found = split(tr, x, lr, r);
+        l = join(tl, t, lr);
+    } else {
+        l = tl;
+        r = tr;
+        if (l != nullptr) {
+            l->parent = nullptr;
+        }
+        if (r != nullptr) {
+            r->parent = nullptr;
+        }
+        t->left = t->right = t->parent = nullptr;
+        update(t);
+        found = t;
+    }
+    return found;
+}
+
+// private unionWith: split t2 by the root of t1 and union the halves independently
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::unionWith(AVLNode * t1, AVLNode * t2) {
+    if (t1 == nullptr) {
+        return t2;
+    }
+    if (t2 == nullptr) {
+        return t1;
+    }
+    AVLNode *l1 = t1->left;
+    AVLNode *r1 = t1->right;
+    AVLNode *l2, *r2;
+    AVLNode *duplicate = split(t2, t1->element, l2, r2);
+    delete duplicate;
+
+    AVLNode *l, *r;
+    bool spawn = height(t1) >= PARALLEL_CUTOFF_HEIGHT && height(t2) >= PARALLEL_CUTOFF_HEIGHT;
+#pragma omp task shared(l) if(spawn)
+    l = unionWith(l1, l2);
+    r = unionWith(r1, r2);
+#pragma omp taskwait
+    return join(l, t1, r);
+}
+
+// private intersectWith: keep the root of t1 only if the split of t2 found it
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::intersectWith(AVLNode * t1, AVLNode * t2) {
+    if (t1 == nullptr || t2 == nullptr) {
+        makeEmpty(t1);
+        makeEmpty(t2);
+        return nullptr;
+    }
+    AVLNode *l1 = t1->left;
+    AVLNode *r1 = t1->right;
+    AVLNode *l2, *r2;
+    AVLNode *duplicate = split(t2, t1->element, l2, r2);
+
+    AVLNode *l, *r;
+    bool spawn = height(t1) >= PARALLEL_CUTOFF_HEIGHT && height(t2) >= PARALLEL_CUTOFF_HEIGHT;
+#pragma omp task shared(l) if(spawn)
+    l = intersectWith(l1, l2);
+    r = intersectWith(r1, r2);
+#pragma omp taskwait
+    if (duplicate != nullptr) {
+        delete duplicate;
+        return join(l, t1, r);
+    }
+    delete t1;
+    return join2(l, r);
+}
+
+// private differenceWith: t1 - t2, splitting t1 by the root of t2
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::differenceWith(AVLNode * t1, AVLNode * t2) {
+    if (t1 == nullptr) {
+        makeEmpty(t2);
+        return nullptr;
+    }
+    if (t2 == nullptr) {
+        return t1;
+    }
+    AVLNode *l2 = t2->left;
+    AVLNode *r2 = t2->right;
+    AVLNode *l1, *r1;
+    AVLNode *duplicate = split(t1, t2->element, l1, r1);
+    delete duplicate;
+
+    AVLNode *l, *r;
+    bool spawn = height(t1) >= PARALLEL_CUTOFF_HEIGHT && height(t2) >= PARALLEL_CUTOFF_HEIGHT;
+#pragma omp task shared(l) if(spawn)
+    l = differenceWith(l1, l2);
+    r = differenceWith(r1, r2);
+#pragma omp taskwait
+    delete t2;
+    return join2(l, r);
+}
+
+// public freeze: the in-order walk already yields the sorted, duplicate-free input the layout needs
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+EytzingerTree<Comparable> AVLTree<Comparable, Aggregate, Instrumentation, Balance>::freeze() const {
+    return EytzingerTree<Comparable>(begin(), end(), treeSize());
+}
+
+// public save
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::save(ostream & out) const {
+    typedef TreeKeyCodec<Comparable> Codec;
+    TreeFileHeader header;
+    memcpy(header.magic, "AVLT", 4);
+    header.version = 1;
+    header.encoding = Codec::ENCODING;
+    header.keyBytes = sizeof(Comparable);
+    header.count = treeSize();
+
+    TreeFileWriter w(out);
+    w.write(&header, sizeof(header));
+    uint64_t codecState = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+        Codec::encode(w, *it, codecState);
+    }
+    w.flush();
+    out.flush();
+    if (!out) {
+        throw runtime_error("AVLTree::save: write failed");
+    }
+}
+
+// public save
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::save(const string & path) const {
+    ofstream out(path.c_str(), ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("AVLTree::save: cannot open " + path);
+    }
+    save(out);
+    out.close(); // the last buffered bytes only reach the file here
+    if (!out) {
+        throw runtime_error("AVLTree::save: write failed on " + path);
+    }
+}
+
+// public load
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::load(istream & in) {
+    TreeStreamReader r(in);
+    loadFrom(r);
+}
+
+// public load
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::load(const string & path) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) {
+        throw runtime_error("AVLTree::load: cannot open " + path);
+    }
+    load(in);
+}
+
+// public loadMapped: the kernel pages the file in as the sequential decode walks over it
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::loadMapped(const string & path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("AVLTree::loadMapped: cannot open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw runtime_error("AVLTree::loadMapped: cannot read " + path);
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw runtime_error("AVLTree::loadMapped: mmap failed for " + path);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    try {
+        TreeMemoryReader r(static_cast<const uint8_t *>(data), size);
+        loadFrom(r);
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+    munmap(data, size);
+}
+
+// private loadFrom: check the header, then build the tree; the old contents go only once that worked
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Reader>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::loadFrom(Reader & r) {
+    typedef TreeKeyCodec<Comparable> Codec;
+    TreeFileHeader header;
+    r.read(&header, sizeof(header));
+    if (memcmp(header.magic, "AVLT", 4) != 0 || header.version != 1) {
+        throw runtime_error("AVLTree::load: not an AVLTree file");
+    }
+    if (header.encoding != Codec::ENCODING || header.keyBytes != sizeof(Comparable)) {
+        throw runtime_error("AVLTree::load: file was written for a different element type");
+    }
+    uint64_t codecState = 0;
+    const Comparable *last = nullptr;
+    AVLNode *t = buildFromSorted(r, header.count, codecState, last);
+    makeEmpty();
+    root = t;
+}
+
+// private buildFromSorted: in-order construction, splitting the n elements at the middle so that sibling
+// subtrees differ in size by at most one; a partially built subtree is freed if the input turns out bad
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+template <typename Reader>
+typename AVLTree<Comparable, Aggregate, Instrumentation, Balance>::AVLNode* AVLTree<Comparable, Aggregate, Instrumentation, Balance>::buildFromSorted(Reader & r, size_t n, uint64_t & codecState, const Comparable * & last) {
+    if (n == 0) {
+        return nullptr;
+    }
+    size_t leftSize = (n - 1) / 2;
+    AVLNode *l = buildFromSorted(r, leftSize, codecState, last);
+    AVLNode *t = nullptr;
+    try {
+        t = new AVLNode(TreeKeyCodec<Comparable>::template decode<Reader>(r, codecState), l, nullptr);
+        if (last != nullptr && !(*last < t->element)) {
+            throw runtime_error("AVLTree::load: elements are not strictly increasing");
+        }
+        last = &t->element;
+        t->right = buildFromSorted(r, n - 1 - leftSize, codecState, last);
+    } catch (...) {
+        if (t != nullptr) {
+            makeEmpty(t);
+        } else {
+            makeEmpty(l);
+        }
+        throw;
+    }
+    if (t->left != nullptr) {
+        t->left->parent = t;
+    }
+    if (t->right != nullptr) {
+        t->right->parent = t;
+    }
+    t->height = Balance::buildRank(n, 1 + max(height(t->left), height(t->right)));
+    update(t);
+    return t;
+}
+
+// public join
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::join(AVLTree & lt, const Comparable & k, AVLTree & rt) {
+    static_assert(Balance::RANK_IS_HEIGHT, "join/split and the set operations are implemented for AVL balancing only");
+    AVLNode *l = lt.root;
+    AVLNode *r = rt.root;
+    lt.root = rt.root = nullptr;
+    makeEmpty();
+    root = join(l, new AVLNode(k, nullptr, nullptr), r);
+}
+
+// public split
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+bool AVLTree<Comparable, Aggregate, Instrumentation, Balance>::split(const Comparable & k, AVLTree & lt, AVLTree & rt) {
+    static_assert(Balance::RANK_IS_HEIGHT, "join/split and the set operations are implemented for AVL balancing only");
+    AVLNode *t = root;
+    root = nullptr;
+    lt.makeEmpty();
+    rt.makeEmpty();
+    AVLNode *found = split(t, k, lt.root, rt.root);
+    if (found == nullptr) {
+        return false;
+    }
+    delete found;
+    return true;
+}
+
+// public unionWith
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::unionWith(AVLTree & other) {
+    static_assert(Balance::RANK_IS_HEIGHT, "join/split and the set operations are implemented for AVL balancing only");
+    if (this == &other) {
+        return;
+    }
+    AVLNode *t1 = root;
+    AVLNode *t2 = other.root;
+    other.root = nullptr;
+#pragma omp parallel
+#pragma omp single
+    root = unionWith(t1, t2);
+}
+
+// public intersectWith
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::intersectWith(AVLTree & other) {
+    static_assert(Balance::RANK_IS_HEIGHT, "join/split and the set operations are implemented for AVL balancing only");
+    if (this == &other) {
+        return;
+    }
+    AVLNode *t1 = root;
+    AVLNode *t2 = other.root;
+    other.root = nullptr;
+#pragma omp parallel
+#pragma omp single
+    root = intersectWith(t1, t2);
+}
+
+// public differenceWith
+template <typename Comparable, typename Aggregate, typename Instrumentation, typename Balance>
+void AVLTree<Comparable, Aggregate, Instrumentation, Balance>::differenceWith(AVLTree & other) {
+    static_assert(Balance::RANK_IS_HEIGHT, "join/split and the set operations are implemented for AVL balancing only");
+    if (this == &other) {
+        makeEmpty();
+        return;
+    }
+    AVLNode *t1 = root;
+    AVLNode *t2 = other.root;
+    other.root = nullptr;
+#pragma omp parallel
+#pragma omp single
+    root = differenceWith(t1, t2);
+}
+
 #endif
\ No newline at end of file
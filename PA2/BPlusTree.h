@@ -0,0 +1,424 @@
+#ifndef BPlusTree_H
+#define BPlusTree_H
+
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// Ordered set stored as a B+tree: all keys live in the leaves, which are linked for range scans,
+// and inner nodes only hold separators. Each node fits in NodeBytes, header and pointers included, and
+// is allocated 64-byte aligned (page aligned from 4096 B up), so that one lookup touches about
+// log_B(n) nodes of NodeBytes / 64 cache lines each instead of the log2(n) of AVLTree. Offers the same contains/insert/remove/
+// findMin/findMax interface as AVLTree so the PA2 experiments can run against either.
+// Comparable must be default constructible (keys are stored in fixed arrays).
+template <typename Comparable, int NodeBytes = 256>
+class BPlusTree
+{
+private:
+    static const int HEADER_BYTES = 2 * sizeof(int);     // Node: isLeaf and count
+    static const int POINTER_BYTES = sizeof(void *);
+    static const int KEY_BYTES = sizeof(Comparable);
+    static const size_t NODE_ALIGN = (NodeBytes >= 4096) ? 4096 : 64;
+
+    // fanout derived from the node size: what is left after the header and pointers, less the one extra
+    // slot a node holds so it can overflow before it splits. A leaf has keys[LEAF_SLOTS + 1], prev and
+    // next; an inner node has keys[INNER_SLOTS + 1] and children[INNER_SLOTS + 2]
+    static const int LEAF_SLOTS = (NodeBytes - HEADER_BYTES - 2 * POINTER_BYTES) / KEY_BYTES - 1;
+    static const int INNER_SLOTS = (NodeBytes - HEADER_BYTES - POINTER_BYTES) / (KEY_BYTES + POINTER_BYTES) - 1;
+    static const int LEAF_MIN = LEAF_SLOTS / 2;
+    static const int INNER_MIN = INNER_SLOTS / 2;
+    static_assert(LEAF_SLOTS >= 4 && INNER_SLOTS >= 4, "BPlusTree NodeBytes too small for four keys per node");
+
+    struct Node
+    {
+        bool isLeaf;
+        int count;      // number of keys in use
+        explicit Node(bool leaf) : isLeaf(leaf), count(0) {}
+
+        // nodes start on a cache line (or page), so a NodeBytes node spans no more lines than it must
+        static void * operator new(size_t size) {
+            void *memory = nullptr;
+            if (posix_memalign(&memory, NODE_ALIGN, size) != 0) {
+                throw bad_alloc();
+            }
+            return memory;
+        }
+        static void operator delete(void * p) { free(p); }
+    };
+
+    struct InnerNode : Node
+    {
+        Comparable keys[INNER_SLOTS + 1];
+        Node *children[INNER_SLOTS + 2];    // children[i] holds keys in [keys[i-1], keys[i])
+        InnerNode() : Node(false) {}
+    };
+
+    struct LeafNode : Node
+    {
+        Comparable keys[LEAF_SLOTS + 1];
+        LeafNode *prev;
+        LeafNode *next;
+        LeafNode() : Node(true), prev(nullptr), next(nullptr) {}
+    };
+
+    static_assert(sizeof(LeafNode) <= NodeBytes, "BPlusTree leaf node larger than NodeBytes");
+    static_assert(sizeof(InnerNode) <= NodeBytes, "BPlusTree inner node larger than NodeBytes");
+
+    Node *root;
+    LeafNode *first;    // leftmost leaf
+    LeafNode *last;     // rightmost leaf
+    int numKeys;
+
+    static InnerNode * inner(Node * n) { return static_cast<InnerNode *>(n); }
+    static LeafNode * leaf(Node * n) { return static_cast<LeafNode *>(n); }
+
+    void makeEmpty(Node * t);
+    LeafNode * findLeaf(const Comparable & x) const;
+    bool insert(const Comparable & x, Node * t, Comparable & splitKey, Node * & splitNode);
+    bool remove(const Comparable & x, Node * t);
+    void fixUnderflow(InnerNode * parent, int i);
+    int computeHeight(Node * t) const;
+
+public:
+    BPlusTree();
+    ~BPlusTree();
+
+    void makeEmpty();
+    const Comparable & findMin() const;
+    const Comparable & findMax() const;
+
+    bool contains(const Comparable & x) const;
+    void insert(const Comparable & x);
+    void remove(const Comparable & x);
+
+    int treeSize() const;
+    int computeHeight() const;
+
+    // calls visit(element) for every element in [lo, hi] in ascending order by walking the leaf chain
+    template <typename Visitor>
+    void rangeVisit(const Comparable & lo, const Comparable & hi, Visitor visit) const;
+
+    static int leafFanout() { return LEAF_SLOTS; }
+    static int innerFanout() { return INNER_SLOTS + 1; }
+
+private:
+    BPlusTree(const BPlusTree &);               // owning raw pointers, not copyable
+    BPlusTree & operator=(const BPlusTree &);
+};
+
+// constructor: an empty tree is a single empty leaf
+template <typename Comparable, int NodeBytes>
+BPlusTree<Comparable, NodeBytes>::BPlusTree() : numKeys(0) {
+    first = last = new LeafNode();
+    root = first;
+}
+
+// destructor
+template <typename Comparable, int NodeBytes>
+BPlusTree<Comparable, NodeBytes>::~BPlusTree() {
+    makeEmpty(root);
+}
+
+// public makeEmpty
+template <typename Comparable, int NodeBytes>
+void BPlusTree<Comparable, NodeBytes>::makeEmpty() {
+    makeEmpty(root);
+    first = last = new LeafNode();
+    root = first;
+    numKeys = 0;
+}
+
+// private makeEmpty
+template <typename Comparable, int NodeBytes>
+void BPlusTree<Comparable, NodeBytes>::makeEmpty(Node * t) {
+    if (!t->isLeaf) {
+        InnerNode *n = inner(t);
+        for (int i = 0; i <= n->count; i++) {
+            makeEmpty(n->children[i]);
+        }
+        delete n;
+    } else {
+        delete leaf(t);
+    }
+}
+
+// public findMin
+template <typename Comparable, int NodeBytes>
+const Comparable & BPlusTree<Comparable, NodeBytes>::findMin() const {
+    if (numKeys == 0) {
+        throw underflow_error("Tree is empty");
+    }
+    return first->keys[0];
+}
+
+// public findMax
+template <typename Comparable, int NodeBytes>
+const Comparable & BPlusTree<Comparable, NodeBytes>::findMax() const {
+    if (numKeys == 0) {
+        throw underflow_error("Tree is empty");
+    }
+    return last->keys[last->count - 1];
+}
+
+// private findLeaf: the only leaf that may contain x
+template <typename Comparable, int NodeBytes>
+typename BPlusTree<Comparable, NodeBytes>::LeafNode * BPlusTree<Comparable, NodeBytes>::findLeaf(const Comparable & x) const {
+    Node *t = root;
+    while (!t->isLeaf) {
+        InnerNode *n = inner(t);
+        int i = upper_bound(n->keys, n->keys + n->count, x) - n->keys;
+        t = n->children[i];
+    }
+    return leaf(t);
+}
+
+// public contains
+template <typename Comparable, int NodeBytes>
+bool BPlusTree<Comparable, NodeBytes>::contains(const Comparable & x) const {
+    LeafNode *l = findLeaf(x);
+    const Comparable *pos = lower_bound(l->keys, l->keys + l->count, x);
+    return pos != l->keys + l->count && !(x < *pos);
+}
+
+// public insert: grow a new root when the old one splits
+template <typename Comparable, int NodeBytes>
+void BPlusTree<Comparable, NodeBytes>::insert(const Comparable & x) {
+    Comparable splitKey;
+    Node *splitNode = nullptr;
+    if (!insert(x, root, splitKey, splitNode)) {
+        return;  // duplicate
+    }
+    numKeys++;
+    if (splitNode != nullptr) {
+        InnerNode *newRoot = new InnerNode();
+        newRoot->keys[0] = splitKey;
+        newRoot->children[0] = root;
+        newRoot->children[1] = splitNode;
+        newRoot->count = 1;
+        root = newRoot;
+    }
+}
+
+// private insert: returns false on duplicates; when t overflows it is split in half and the new
+// right sibling and its separator are handed back to the caller
+template <typename Comparable, int NodeBytes>
+bool BPlusTree<Comparable, NodeBytes>::insert(const Comparable & x, Node * t, Comparable & splitKey, Node * & splitNode) {
+    if (t->isLeaf) {
+        LeafNode *l = leaf(t);
+        Comparable *pos = lower_bound(l->keys, l->keys + l->count, x);
+        if (pos != l->keys + l->count && !(x < *pos)) {
+            return false;
+        }
+        copy_backward(pos, l->keys + l->count, l->keys + l->count + 1);
+        *pos = x;
+        l->count++;
+        if (l->count > LEAF_SLOTS) {
+            LeafNode *sibling = new LeafNode();
+            int keep = l->count / 2;
+            copy(l->keys + keep, l->keys + l->count, sibling->keys);
+            sibling->count = l->count - keep;
+            l->count = keep;
+            sibling->next = l->next;
+            sibling->prev = l;
+            if (l->next != nullptr) {
+                l->next->prev = sibling;
+            } else {
+                last = sibling;
+            }
+            l->next = sibling;
+            splitKey = sibling->keys[0];
+            splitNode = sibling;
+        }
+        return true;
+    }
+
+    InnerNode *n = inner(t);
+    int i = upper_bound(n->keys, n->keys + n->count, x) - n->keys;
+    Comparable childKey;
+    Node *childSplit = nullptr;
+    if (!insert(x, n->children[i], childKey, childSplit)) {
+        return false;
+    }
+    if (childSplit != nullptr) {
+        copy_backward(n->keys + i, n->keys + n->count, n->keys + n->count + 1);
+        copy_backward(n->children + i + 1, n->children + n->count + 1, n->children + n->count + 2);
+        n->keys[i] = childKey;
+        n->children[i + 1] = childSplit;
+        n->count++;
+        if (n->count > INNER_SLOTS) {
+            // the middle key moves up; the keys right of it go to the new sibling
+            InnerNode *sibling = new InnerNode();
+            int mid = n->count / 2;
+            splitKey = n->keys[mid];
+            copy(n->keys + mid + 1, n->keys + n->count, sibling->keys);
+            copy(n->children + mid + 1, n->children + n->count + 1, sibling->children);
+            sibling->count = n->count - mid - 1;
+            n->count = mid;
+            splitNode = sibling;
+        }
+    }
+    return true;
+}
+
+// public remove: collapse the root when it is left with a single child
+template <typename Comparable, int NodeBytes>
+void BPlusTree<Comparable, NodeBytes>::remove(const Comparable & x) {
+    if (!remove(x, root)) {
+        return;
+    }
+    numKeys--;
+    if (!root->isLeaf && root->count == 0) {
+        InnerNode *oldRoot = inner(root);
+        root = oldRoot->children[0];
+        delete oldRoot;
+    }
+}
+
+// private remove: returns false if x was not found; underfull children are fixed by the parent
+template <typename Comparable, int NodeBytes>
+bool BPlusTree<Comparable, NodeBytes>::remove(const Comparable & x, Node * t) {
+    if (t->isLeaf) {
+        LeafNode *l = leaf(t);
+        Comparable *pos = lower_bound(l->keys, l->keys + l->count, x);
+        if (pos == l->keys + l->count || x < *pos) {
+            return false;
+        }
+        copy(pos + 1, l->keys + l->count, pos);
+        l->count--;
+        return true;
+    }
+
+    InnerNode *n = inner(t);
+    int i = upper_bound(n->keys, n->keys + n->count, x) - n->keys;
+    if (!remove(x, n->children[i])) {
+        return false;
+    }
+    Node *child = n->children[i];
+    if (child->count < (child->isLeaf ? LEAF_MIN : INNER_MIN)) {
+        fixUnderflow(n, i);
+    }
+    return true;
+}
+
+// private fixUnderflow: borrow one key from a sibling that can spare it, otherwise merge with a sibling.
+// Separators left stale by removals still separate correctly, so they are only rewritten when keys move.
+template <typename Comparable, int NodeBytes>
+void BPlusTree<Comparable, NodeBytes>::fixUnderflow(InnerNode * parent, int i) {
+    Node *child = parent->children[i];
+    Node *left = (i > 0) ? parent->children[i - 1] : nullptr;
+    Node *right = (i < parent->count) ? parent->children[i + 1] : nullptr;
+    int minKeys = child->isLeaf ? LEAF_MIN : INNER_MIN;
+
+    if (left != nullptr && left->count > minKeys) {
+        if (child->isLeaf) {
+            LeafNode *c = leaf(child), *l = leaf(left);
+            copy_backward(c->keys, c->keys + c->count, c->keys + c->count + 1);
+            c->keys[0] = l->keys[l->count - 1];
+            parent->keys[i - 1] = c->keys[0];
+        } else {
+            InnerNode *c = inner(child), *l = inner(left);
+            copy_backward(c->keys, c->keys + c->count, c->keys + c->count + 1);
+            copy_backward(c->children, c->children + c->count + 1, c->children + c->count + 2);
+            c->keys[0] = parent->keys[i - 1];
+            c->children[0] = l->children[l->count];
+            parent->keys[i - 1] = l->keys[l->count - 1];
+        }
+        left->count--;
+        child->count++;
+        return;
+    }
+
+    if (right != nullptr && right->count > minKeys) {
+        if (child->isLeaf) {
+            LeafNode *c = leaf(child), *r = leaf(right);
+            c->keys[c->count] = r->keys[0];
+            copy(r->keys + 1, r->keys + r->count, r->keys);
+            parent->keys[i] = r->keys[0];
+        } else {
+            InnerNode *c = inner(child), *r = inner(right);
+            c->keys[c->count] = parent->keys[i];
+            c->children[c->count + 1] = r->children[0];
+            parent->keys[i] = r->keys[0];
+            copy(r->keys + 1, r->keys + r->count, r->keys);
+            copy(r->children + 1, r->children + r->count + 1, r->children);
+        }
+        right->count--;
+        child->count++;
+        return;
+    }
+
+    // merge children[j + 1] into children[j] and drop separator j from the parent
+    int j = (left != nullptr) ? i - 1 : i;
+    Node *a = parent->children[j];
+    Node *b = parent->children[j + 1];
+    if (a->isLeaf) {
+        LeafNode *la = leaf(a), *lb = leaf(b);
+        copy(lb->keys, lb->keys + lb->count, la->keys + la->count);
+        la->count += lb->count;
+        la->next = lb->next;
+        if (lb->next != nullptr) {
+            lb->next->prev = la;
+        } else {
+            last = la;
+        }
+        delete lb;
+    } else {
+        InnerNode *ia = inner(a), *ib = inner(b);
+        ia->keys[ia->count] = parent->keys[j];
+        copy(ib->keys, ib->keys + ib->count, ia->keys + ia->count + 1);
+        copy(ib->children, ib->children + ib->count + 1, ia->children + ia->count + 1);
+        ia->count += ib->count + 1;
+        delete ib;
+    }
+    copy(parent->keys + j + 1, parent->keys + parent->count, parent->keys + j);
+    copy(parent->children + j + 2, parent->children + parent->count + 1, parent->children + j + 1);
+    parent->count--;
+}
+
+// public treeSize: kept as a counter, O(1)
+template <typename Comparable, int NodeBytes>
+int BPlusTree<Comparable, NodeBytes>::treeSize() const {
+    return numKeys;
+}
+
+// public computeHeight: number of levels above the leaves, so a single leaf has height 0
+template <typename Comparable, int NodeBytes>
+int BPlusTree<Comparable, NodeBytes>::computeHeight() const {
+    return computeHeight(root);
+}
+
+// private computeHeight: every leaf is at the same depth, so follow the leftmost path
+template <typename Comparable, int NodeBytes>
+int BPlusTree<Comparable, NodeBytes>::computeHeight(Node * t) const {
+    int h = 0;
+    while (!t->isLeaf) {
+        t = inner(t)->children[0];
+        h++;
+    }
+    return h;
+}
+
+// public rangeVisit: one descent to the first leaf, then a sequential scan along the leaf chain
+template <typename Comparable, int NodeBytes>
+template <typename Visitor>
+void BPlusTree<Comparable, NodeBytes>::rangeVisit(const Comparable & lo, const Comparable & hi, Visitor visit) const {
+    LeafNode *l = findLeaf(lo);
+    int i = lower_bound(l->keys, l->keys + l->count, lo) - l->keys;
+    while (l != nullptr) {
+        for (; i < l->count; i++) {
+            if (hi < l->keys[i]) {
+                return;
+            }
+            visit(l->keys[i]);
+        }
+        l = l->next;
+        i = 0;
+    }
+}
+
+#endif
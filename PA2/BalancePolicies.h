@@ -0,0 +1,362 @@
+#ifndef BalancePolicies_H
+#define BalancePolicies_H
+
+#include <cstdlib>
+#include <cstddef>
+
+using namespace std;
+
+// Balancing policies for AVLTree<Comparable, Aggregate, Instrumentation, Balance>, all phrased as
+// rank-balanced trees (Haeupler, Sen and Tarjan, "Rank-Balanced Trees"): every node stores a rank in
+// its height field, a missing child has rank -1, and each policy is a rule on the rank differences
+// between a node and its children.
+//
+// The tree calls afterInsert(tree, t) / afterRemove(tree, t) on every node of the search path, bottom
+// up, once the subtree below t is valid again; the policy repairs t locally and any violation it pushes
+// up is seen by the next call. check(t) states the rule for one node, for AVLTree::validate().
+// buildRank(size, height) gives the rank of a node in a tree built by always splitting at the middle.
+//
+//   AVLBalance      rank == height, children differ by at most 1; the textbook code in AVLTree::balance
+//   WAVLBalance     rank differences 1 or 2, leaves have rank 0; inserts rebalance exactly like AVL, but a
+//                   remove does at most two rotations (AVL may rotate at every level)
+//   RedBlackBalance rank == black height, differences 0 (red) or 1 (black), no 0-child has a 0-child;
+//                   at most two rotations per insert and three per remove
+
+struct AVLBalance
+{
+    static const bool RANK_IS_HEIGHT = true;   // join/split/set operations rely on this
+    static const char * name() { return "AVL"; }
+    static int buildRank(size_t, int height) { return height; }
+
+    template <typename Tree, typename Node>
+    static void afterInsert(Tree & tree, Node * & t) { tree.balance(t); }
+
+    template <typename Tree, typename Node>
+    static void afterRemove(Tree & tree, Node * & t) { tree.balance(t); }
+
+    template <typename Node>
+    static const char * check(const Node * t) {
+        int hl = (t->left == nullptr) ? -1 : t->left->height;
+        int hr = (t->right == nullptr) ? -1 : t->right->height;
+        if (t->height != 1 + (hl > hr ? hl : hr)) {
+            return "cached height is stale";
+        }
+        if (abs(hl - hr) > 1) {
+            return "AVL balance condition violated";
+        }
+        return nullptr;
+    }
+};
+
+struct WAVLBalance
+{
+    static const bool RANK_IS_HEIGHT = false;
+    static const char * name() { return "WAVL"; }
+    static int buildRank(size_t, int height) { return height; }   // such a tree is AVL, hence WAVL with rank = height
+
+    template <typename Node>
+    static int rank(const Node * t) { return (t == nullptr) ? -1 : t->height; }
+
+    template <typename Tree, typename Node>
+    static void afterInsert(Tree & tree, Node * & t);
+
+    template <typename Tree, typename Node>
+    static void afterRemove(Tree & tree, Node * & t);
+
+    template <typename Node>
+    static const char * check(const Node * t) {
+        int dl = t->height - rank(t->left);
+        int dr = t->height - rank(t->right);
+        if (dl < 1 || dl > 2 || dr < 1 || dr > 2) {
+            return "WAVL rank difference outside 1..2";
+        }
+        if (t->left == nullptr && t->right == nullptr && t->height != 0) {
+            return "WAVL leaf with nonzero rank";
+        }
+        return nullptr;
+    }
+};
+
+// WAVLBalance afterInsert: a child with rank difference 0 is either fixed by promoting t (its sibling
+// is a 1-child) or by the same single/double rotation AVL would do
+template <typename Tree, typename Node>
+void WAVLBalance::afterInsert(Tree & tree, Node * & t) {
+    if (t == nullptr) {
+        return;
+    }
+    int dl = t->height - rank(t->left);
+    int dr = t->height - rank(t->right);
+    if (dl == 0) {
+        Node *x = t->left;
+        if (dr == 1) {
+            t->height++;
+            tree.countRebalanceStep();
+        } else if (x->height - rank(x->left) == 1) {
+            Node *z = t;
+            tree.rotateWithLeftChild(t);
+            z->height--;
+            tree.countRotation(false);
+        } else {
+            Node *z = t;
+            Node *y = x->right;
+            tree.doubleWithLeftChild(t);
+            y->height++;
+            x->height--;
+            z->height--;
+            tree.countRotation(true);
+        }
+    } else if (dr == 0) {
+        Node *x = t->right;
+        if (dl == 1) {
+            t->height++;
+            tree.countRebalanceStep();
+        } else if (x->height - rank(x->right) == 1) {
+            Node *z = t;
+            tree.rotateWithRightChild(t);
+            z->height--;
+            tree.countRotation(false);
+        } else {
+            Node *z = t;
+            Node *y = x->left;
+            tree.doubleWithRightChild(t);
+            y->height++;
+            x->height--;
+            z->height--;
+            tree.countRotation(true);
+        }
+    }
+    tree.update(t);
+}
+
+// WAVLBalance afterRemove: a 2,2 leaf or a 3-child is fixed by demotions, which may move the problem
+// up one level, or by one single/double rotation, which ends the rebalancing
+template <typename Tree, typename Node>
+void WAVLBalance::afterRemove(Tree & tree, Node * & t) {
+    if (t == nullptr) {
+        return;
+    }
+    if (t->left == nullptr && t->right == nullptr) {
+        if (t->height != 0) {
+            t->height = 0;
+            tree.countRebalanceStep();
+        }
+        tree.update(t);
+        return;
+    }
+    int dl = t->height - rank(t->left);
+    int dr = t->height - rank(t->right);
+    if (dl == 3) {
+        Node *y = t->right;
+        if (dr == 2) {
+            t->height--;
+            tree.countRebalanceStep();
+        } else if (y->height - rank(y->left) == 2 && y->height - rank(y->right) == 2) {
+            t->height--;
+            y->height--;
+            tree.countRebalanceStep();
+        } else if (y->height - rank(y->right) == 1) {
+            Node *z = t;
+            tree.rotateWithRightChild(t);
+            y->height++;
+            z->height--;
+            if (z->left == nullptr && z->right == nullptr) {
+                z->height = 0;
+            }
+            tree.countRotation(false);
+        } else {
+            Node *z = t;
+            Node *w = y->left;
+            tree.doubleWithRightChild(t);
+            w->height += 2;
+            y->height--;
+            z->height -= 2;
+            tree.countRotation(true);
+        }
+    } else if (dr == 3) {
+        Node *y = t->left;
+        if (dl == 2) {
+            t->height--;
+            tree.countRebalanceStep();
+        } else if (y->height - rank(y->left) == 2 && y->height - rank(y->right) == 2) {
+            t->height--;
+            y->height--;
+            tree.countRebalanceStep();
+        } else if (y->height - rank(y->left) == 1) {
+            Node *z = t;
+            tree.rotateWithLeftChild(t);
+            y->height++;
+            z->height--;
+            if (z->left == nullptr && z->right == nullptr) {
+                z->height = 0;
+            }
+            tree.countRotation(false);
+        } else {
+            Node *z = t;
+            Node *w = y->right;
+            tree.doubleWithLeftChild(t);
+            w->height += 2;
+            y->height--;
+            z->height -= 2;
+            tree.countRotation(true);
+        }
+    }
+    tree.update(t);
+}
+
+struct RedBlackBalance
+{
+    static const bool RANK_IS_HEIGHT = false;
+    static const char * name() { return "red-black"; }
+
+    // black height = number of complete levels; only the nodes of a partial bottom level end up red
+    static int buildRank(size_t size, int) {
+        int r = -1;
+        for (size_t full = size + 1; full > 1; full >>= 1) {
+            r++;
+        }
+        return r;
+    }
+
+    template <typename Node>
+    static int rank(const Node * t) { return (t == nullptr) ? -1 : t->height; }
+
+    // a red node is a child with rank difference 0
+    template <typename Node>
+    static bool isRed(const Node * parent, const Node * child) { return child != nullptr && child->height == parent->height; }
+
+    template <typename Tree, typename Node>
+    static void afterInsert(Tree & tree, Node * & t);
+
+    template <typename Tree, typename Node>
+    static void afterRemove(Tree & tree, Node * & t);
+
+    template <typename Node>
+    static const char * check(const Node * t) {
+        int dl = t->height - rank(t->left);
+        int dr = t->height - rank(t->right);
+        if (t->height < 0 || dl < 0 || dl > 1 || dr < 0 || dr > 1) {
+            return "red-black rank difference outside 0..1";
+        }
+        if ((isRed(t, t->left) && (isRed(t->left, t->left->left) || isRed(t->left, t->left->right))) ||
+            (isRed(t, t->right) && (isRed(t->right, t->right->left) || isRed(t->right, t->right->right)))) {
+            return "red node with a red child";
+        }
+        return nullptr;
+    }
+
+private:
+    template <typename Tree, typename Node>
+    static void fixLeftDeficit(Tree & tree, Node * & t);
+    template <typename Tree, typename Node>
+    static void fixRightDeficit(Tree & tree, Node * & t);
+};
+
+// RedBlackBalance afterInsert: t is the grandparent of a red-red pair. A red uncle means recoloring,
+// which in ranks is promoting t; otherwise one single/double rotation, with no rank changes, ends it
+template <typename Tree, typename Node>
+void RedBlackBalance::afterInsert(Tree & tree, Node * & t) {
+    if (t == nullptr) {
+        return;
+    }
+    Node *p = t->left;
+    Node *q = t->right;
+    if (isRed(t, p) && (isRed(p, p->left) || isRed(p, p->right))) {
+        if (isRed(t, q)) {
+            t->height++;
+            tree.countRebalanceStep();
+        } else if (isRed(p, p->left)) {
+            tree.rotateWithLeftChild(t);
+            tree.countRotation(false);
+        } else {
+            tree.doubleWithLeftChild(t);
+            tree.countRotation(true);
+        }
+    } else if (isRed(t, q) && (isRed(q, q->left) || isRed(q, q->right))) {
+        if (isRed(t, p)) {
+            t->height++;
+            tree.countRebalanceStep();
+        } else if (isRed(q, q->right)) {
+            tree.rotateWithRightChild(t);
+            tree.countRotation(false);
+        } else {
+            tree.doubleWithRightChild(t);
+            tree.countRotation(true);
+        }
+    }
+    tree.update(t);
+}
+
+// RedBlackBalance afterRemove: removing a black node leaves a child with rank difference 2 below t
+template <typename Tree, typename Node>
+void RedBlackBalance::afterRemove(Tree & tree, Node * & t) {
+    if (t == nullptr) {
+        return;
+    }
+    if (t->height - rank(t->left) == 2) {
+        fixLeftDeficit(tree, t);
+    } else if (t->height - rank(t->right) == 2) {
+        fixRightDeficit(tree, t);
+    }
+    tree.update(t);
+}
+
+// RedBlackBalance fixLeftDeficit: a red sibling is rotated above t first, so that t, now red, has a black
+// sibling; then either demote t (black nephews) or rotate a red nephew into place
+template <typename Tree, typename Node>
+void RedBlackBalance::fixLeftDeficit(Tree & tree, Node * & t) {
+    Node *s = t->right;
+    if (isRed(t, s)) {
+        tree.rotateWithRightChild(t);
+        tree.countRotation(false);
+        fixLeftDeficit(tree, t->left);
+        tree.update(t);
+        return;
+    }
+    Node *z = t;
+    if (!isRed(s, s->left) && !isRed(s, s->right)) {
+        t->height--;
+        tree.countRebalanceStep();
+    } else if (isRed(s, s->right)) {
+        tree.rotateWithRightChild(t);
+        s->height++;
+        z->height--;
+        tree.countRotation(false);
+    } else {
+        Node *w = s->left;
+        tree.doubleWithRightChild(t);
+        w->height++;
+        z->height--;
+        tree.countRotation(true);
+    }
+}
+
+// RedBlackBalance fixRightDeficit: mirror of fixLeftDeficit
+template <typename Tree, typename Node>
+void RedBlackBalance::fixRightDeficit(Tree & tree, Node * & t) {
+    Node *s = t->left;
+    if (isRed(t, s)) {
+        tree.rotateWithLeftChild(t);
+        tree.countRotation(false);
+        fixRightDeficit(tree, t->right);
+        tree.update(t);
+        return;
+    }
+    Node *z = t;
+    if (!isRed(s, s->left) && !isRed(s, s->right)) {
+        t->height--;
+        tree.countRebalanceStep();
+    } else if (isRed(s, s->left)) {
+        tree.rotateWithLeftChild(t);
+        s->height++;
+        z->height--;
+        tree.countRotation(false);
+    } else {
+        Node *w = s->right;
+        tree.doubleWithLeftChild(t);
+        w->height++;
+        z->height--;
+        tree.countRotation(true);
+    }
+}
+
+#endif
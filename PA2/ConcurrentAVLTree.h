@@ -0,0 +1,676 @@
+#ifndef ConcurrentAVLTree_H
+#define ConcurrentAVLTree_H
+
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+//***************************************************************************//
+//**  Epoch-based reclamation
+//***************************************************************************//
+
+// Nodes unlinked by a writer may still be read by optimistic readers, so they are not deleted at once.
+// Each thread announces the global epoch while it is inside an operation; a retired node is freed
+// only after the global epoch has advanced twice past its retirement, at which point no thread can
+// still hold a pointer to it.
+class EpochManager
+{
+public:
+    static const int MAX_THREADS = 256;
+
+    // the slots get their own cache-line aligned buffer: new does not honour alignas before C++17
+    EpochManager() : globalEpoch(2), slots(nullptr) {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, 64, MAX_THREADS * sizeof(Slot)) != 0) {
+            throw bad_alloc();
+        }
+        slots = static_cast<Slot *>(memory);
+        for (int i = 0; i < MAX_THREADS; i++) {
+            new (&slots[i]) Slot();
+            slots[i].epoch.store(INACTIVE);
+        }
+    }
+
+    // frees everything still pending; no thread may be inside an operation
+    ~EpochManager() {
+        for (int i = 0; i < MAX_THREADS; i++) {
+            for (size_t j = 0; j < slots[i].retired.size(); j++) {
+                slots[i].retired[j].deleter(slots[i].retired[j].ptr);
+            }
+            slots[i].~Slot();
+        }
+        free(slots);
+    }
+
+    void enter() { slots[threadSlot()].epoch.store(globalEpoch.load()); }
+    void exit() { slots[threadSlot()].epoch.store(INACTIVE); }
+
+    // hand a node that is no longer reachable to the reclaimer
+    void retire(void * ptr, void (*deleter)(void *)) {
+        Slot & slot = slots[threadSlot()];
+        Retired r = { ptr, deleter, globalEpoch.load() };
+        slot.retired.push_back(r);
+        if (slot.retired.size() >= RECLAIM_BATCH) {
+            tryAdvance();
+            reclaim(slot);
+        }
+    }
+
+    // RAII guard for one tree operation
+    class Guard
+    {
+    public:
+        explicit Guard(EpochManager & m) : manager(m) { manager.enter(); }
+        ~Guard() { manager.exit(); }
+    private:
+        EpochManager & manager;
+    };
+
+private:
+    static const uint64_t INACTIVE = UINT64_MAX;
+    static const size_t RECLAIM_BATCH = 128;
+
+    struct Retired
+    {
+        void *ptr;
+        void (*deleter)(void *);
+        uint64_t epoch;
+    };
+
+    // one cache line per slot so that threads announcing epochs do not false-share
+    struct alignas(64) Slot
+    {
+        atomic<uint64_t> epoch;
+        vector<Retired> retired;    // only touched by the thread owning the slot
+    };
+
+    atomic<uint64_t> globalEpoch;
+    Slot *slots;                    // MAX_THREADS of them, 64-byte aligned
+
+    EpochManager(const EpochManager &);             // owns an aligned buffer, not copyable
+    EpochManager & operator=(const EpochManager &);
+
+    // the epoch can move on once every active thread has observed the current one
+    void tryAdvance() {
+        uint64_t e = globalEpoch.load();
+        for (int i = 0; i < MAX_THREADS; i++) {
+            uint64_t seen = slots[i].epoch.load();
+            if (seen != INACTIVE && seen != e) {
+                return;
+            }
+        }
+        globalEpoch.compare_exchange_strong(e, e + 1);
+    }
+
+    void reclaim(Slot & slot) {
+        uint64_t e = globalEpoch.load();
+        size_t kept = 0;
+        for (size_t j = 0; j < slot.retired.size(); j++) {
+            if (slot.retired[j].epoch + 2 <= e) {
+                slot.retired[j].deleter(slot.retired[j].ptr);
+            } else {
+                slot.retired[kept++] = slot.retired[j];
+            }
+        }
+        slot.retired.resize(kept);
+    }
+
+    // process-wide slot index for the calling thread, released again when the thread exits
+    static int threadSlot() {
+        static atomic<bool> used[MAX_THREADS];
+        struct Handle
+        {
+            int id;
+            Handle() : id(-1) {
+                for (int i = 0; i < MAX_THREADS; i++) {
+                    bool expected = false;
+                    if (!used[i].load() && used[i].compare_exchange_strong(expected, true)) {
+                        id = i;
+                        return;
+                    }
+                }
+                throw runtime_error("EpochManager: too many threads");
+            }
+            ~Handle() { used[id].store(false); }
+        };
+        static thread_local Handle handle;
+        return handle.id;
+    }
+};
+
+//***************************************************************************//
+//**  Concurrent AVL tree with optimistic lock coupling
+//***************************************************************************//
+
+// Ordered set for many readers and a few writers. Every node carries a version lock:
+//   bit 0 = obsolete (node was unlinked), bit 1 = locked, the rest counts modifications.
+// Readers never write shared memory. They remember a node's version, read its key and child pointer,
+// and check that the version did not change; if it did, the search restarts from the root.
+// Writers find their position the same way and then lock only the nodes they modify: the parent of a
+// new leaf, the nodes around an unlinked node, and the two or three nodes taking part in a rotation.
+// Locks are always taken top-down (parent before child), so writers cannot deadlock.
+// Rebalancing walks up via parent pointers after each update; concurrent writers may briefly leave the
+// tree imbalanced, but once the tree is quiescent it satisfies the AVL condition again.
+//
+// Keys are stored in atomics, so Comparable must be trivially copyable (ints in practice).
+template <typename Comparable>
+class ConcurrentAVLTree
+{
+private:
+    static_assert(is_trivially_copyable<Comparable>::value, "ConcurrentAVLTree keys must be trivially copyable");
+
+    static const uint64_t OBSOLETE = 1;
+    static const uint64_t LOCKED = 2;
+
+    struct CNode
+    {
+        atomic<Comparable> element;
+        atomic<CNode *> left;
+        atomic<CNode *> right;
+        atomic<CNode *> parent;     // only followed by writers, who re-check it under the parent's lock
+        atomic<int> height;
+        atomic<uint64_t> version;
+
+        CNode( const Comparable & theElement, CNode *pt ) : element(theElement), left(nullptr), right(nullptr), parent(pt), height(0), version(0) {}
+    };
+
+    CNode *holder;          // sentinel above the root; the real root is holder->right
+    EpochManager epochs;
+
+    static int height(CNode * t) { return (t == nullptr) ? -1 : t->height.load(memory_order_relaxed); }
+    static void deleteNode(void * p) { delete static_cast<CNode *>(p); }
+
+    // version lock operations; the bool results are false when the caller has to restart
+    static bool readLock(CNode * t, uint64_t & v);
+    // the fence keeps the relaxed key loads before it from being satisfied after the version re-check
+    static bool validate(CNode * t, uint64_t v) { atomic_thread_fence(memory_order_acquire); return t->version.load() == v; }
+    static bool upgradeToWriteLock(CNode * t, uint64_t v) { return t->version.compare_exchange_strong(v, v + LOCKED); }
+    static void writeLock(CNode * t);
+    static void writeUnlock(CNode * t) { t->version.fetch_add(LOCKED); }
+    static void writeUnlockObsolete(CNode * t) { t->version.fetch_add(LOCKED + OBSOLETE); }
+    static void pause();
+
+    // one attempt at each operation; false means a version check failed and the attempt must be repeated
+    bool containsOnce(const Comparable & x, bool & found);
+    bool insertOnce(const Comparable & x, bool & inserted);
+    bool removeOnce(const Comparable & x, bool & removed);
+    void removeNode(CNode * p, CNode * n);
+    void rebalance(CNode * t);
+    CNode * lockParentOf(CNode * t);
+    void rotateWithLeftChild(CNode * p, CNode * k2);
+    void rotateWithRightChild(CNode * p, CNode * k2);
+    static void replaceChild(CNode * p, CNode * oldChild, CNode * newChild);
+    static void update(CNode * t) { t->height.store(1 + max(height(t->left.load()), height(t->right.load())), memory_order_relaxed); }
+
+    void makeEmpty(CNode * t);
+    int treeSize(CNode * t) const;
+    int computeHeight(CNode * t) const;
+    bool isBalanced(CNode * t) const;
+    bool isBST(CNode * t, const Comparable * lo, const Comparable * hi) const;
+
+    ConcurrentAVLTree(const ConcurrentAVLTree &);
+    ConcurrentAVLTree & operator=(const ConcurrentAVLTree &);
+
+public:
+    ConcurrentAVLTree();
+    ~ConcurrentAVLTree();
+
+    // safe to call from any number of threads concurrently
+    bool contains(const Comparable & x);
+    bool insert(const Comparable & x);     // true if x was added
+    bool remove(const Comparable & x);     // true if x was removed
+
+    // inspection helpers; only meaningful while no other thread is modifying the tree
+    int treeSize() const { return treeSize(holder->right.load()); }
+    int computeHeight() const { return computeHeight(holder->right.load()); }
+    bool isBalanced() const { return isBalanced(holder->right.load()); }
+    bool isBST() const { return isBST(holder->right.load(), nullptr, nullptr); }
+
+    static const int ALLOWED_IMBALANCE = 1;
+};
+
+// constructor
+template <typename Comparable>
+ConcurrentAVLTree<Comparable>::ConcurrentAVLTree() : holder(new CNode(Comparable(), nullptr)) {}
+
+// destructor: pending retired nodes are freed by the EpochManager destructor
+template <typename Comparable>
+ConcurrentAVLTree<Comparable>::~ConcurrentAVLTree() {
+    makeEmpty(holder->right.load());
+    delete holder;
+}
+
+// private makeEmpty
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::makeEmpty(CNode * t) {
+    if (t != nullptr) {
+        makeEmpty(t->left.load());
+        makeEmpty(t->right.load());
+        delete t;
+    }
+}
+
+// private pause: back off while a node is locked; yielding keeps oversubscribed runs moving
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::pause() {
+    this_thread::yield();
+}
+
+// private readLock: wait out a writer, give up on unlinked nodes
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::readLock(CNode * t, uint64_t & v) {
+    v = t->version.load();
+    while (v & LOCKED) {
+        pause();
+        v = t->version.load();
+    }
+    return !(v & OBSOLETE);
+}
+
+// private writeLock: unconditional lock, used while walking up to rebalance
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::writeLock(CNode * t) {
+    while (true) {
+        uint64_t v = t->version.load();
+        if (!(v & LOCKED) && t->version.compare_exchange_weak(v, v + LOCKED)) {
+            return;
+        }
+        pause();
+    }
+}
+
+// public contains
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::contains(const Comparable & x) {
+    EpochManager::Guard guard(epochs);
+    bool found;
+    while (!containsOnce(x, found)) {
+    }
+    return found;
+}
+
+// private containsOnce: hand-over-hand optimistic descent; a node's version is validated after reading
+// the child pointer from it, and the parent's version after the child's version is taken
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::containsOnce(const Comparable & x, bool & found) {
+    CNode *p = holder;
+    uint64_t pv, nv;
+    if (!readLock(p, pv)) {
+        return false;
+    }
+    CNode *n = p->right.load();
+    if (!validate(p, pv)) {
+        return false;
+    }
+    while (n != nullptr) {
+        if (!readLock(n, nv) || !validate(p, pv)) {
+            return false;
+        }
+        Comparable key = n->element.load(memory_order_relaxed);
+        if (!(x < key) && !(key < x)) {
+            found = true;
+            return validate(n, nv);
+        }
+        CNode *child = (x < key) ? n->left.load() : n->right.load();
+        if (!validate(n, nv)) {
+            return false;
+        }
+        p = n;
+        pv = nv;
+        n = child;
+    }
+    found = false;
+    return true;
+}
+
+// public insert
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::insert(const Comparable & x) {
+    EpochManager::Guard guard(epochs);
+    bool inserted;
+    while (!insertOnce(x, inserted)) {
+    }
+    return inserted;
+}
+
+// private insertOnce: optimistic descent, then lock only the parent of the new leaf
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::insertOnce(const Comparable & x, bool & inserted) {
+    CNode *p = holder;
+    uint64_t pv, nv;
+    bool goLeft = false;
+    if (!readLock(p, pv)) {
+        return false;
+    }
+    CNode *n = p->right.load();
+    if (!validate(p, pv)) {
+        return false;
+    }
+    while (n != nullptr) {
+        if (!readLock(n, nv) || !validate(p, pv)) {
+            return false;
+        }
+        Comparable key = n->element.load(memory_order_relaxed);
+        if (!(x < key) && !(key < x)) {
+            inserted = false;
+            return validate(n, nv);
+        }
+        goLeft = x < key;
+        CNode *child = goLeft ? n->left.load() : n->right.load();
+        if (!validate(n, nv)) {
+            return false;
+        }
+        p = n;
+        pv = nv;
+        n = child;
+    }
+
+    // the version check inside the upgrade proves the child slot we saw empty is still empty
+    if (!upgradeToWriteLock(p, pv)) {
+        return false;
+    }
+    CNode *leaf = new CNode(x, p);
+    if (p == holder || !goLeft) {
+        p->right.store(leaf);
+    } else {
+        p->left.store(leaf);
+    }
+    writeUnlock(p);
+    if (p != holder) {
+        rebalance(p);
+    }
+    inserted = true;
+    return true;
+}
+
+// public remove
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::remove(const Comparable & x) {
+    EpochManager::Guard guard(epochs);
+    bool removed;
+    while (!removeOnce(x, removed)) {
+    }
+    return removed;
+}
+
+// private removeOnce: find x optimistically, then lock its parent and the node itself
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::removeOnce(const Comparable & x, bool & removed) {
+    CNode *p = holder;
+    uint64_t pv, nv;
+    if (!readLock(p, pv)) {
+        return false;
+    }
+    CNode *n = p->right.load();
+    if (!validate(p, pv)) {
+        return false;
+    }
+    while (n != nullptr) {
+        if (!readLock(n, nv) || !validate(p, pv)) {
+            return false;
+        }
+        Comparable key = n->element.load(memory_order_relaxed);
+        if (!(x < key) && !(key < x)) {
+            if (!upgradeToWriteLock(p, pv)) {
+                return false;
+            }
+            if (!upgradeToWriteLock(n, nv)) {
+                writeUnlock(p);
+                return false;
+            }
+            removeNode(p, n);
+            removed = true;
+            return true;
+        }
+        CNode *child = (x < key) ? n->left.load() : n->right.load();
+        if (!validate(n, nv)) {
+            return false;
+        }
+        p = n;
+        pv = nv;
+        n = child;
+    }
+    removed = false;
+    return true;
+}
+
+// private removeNode: p and n are locked by the caller and both are unlocked here.
+// A node with two children takes over its successor's key and the successor is unlinked instead.
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::removeNode(CNode * p, CNode * n) {
+    CNode *l = n->left.load();
+    CNode *r = n->right.load();
+    if (l == nullptr || r == nullptr) {
+        CNode *c = (l != nullptr) ? l : r;
+        if (c != nullptr) {
+            writeLock(c);
+        }
+        replaceChild(p, n, c);
+        if (c != nullptr) {
+            c->parent.store(p);
+            writeUnlock(c);
+        }
+        writeUnlockObsolete(n);
+        writeUnlock(p);
+        epochs.retire(n, deleteNode);
+        if (p != holder) {
+            rebalance(p);
+        }
+        return;
+    }
+
+    // lock down the left spine of the right subtree, hand over hand, keeping the successor s and its parent sp
+    writeUnlock(p);
+    CNode *sp = n;
+    CNode *s = r;
+    writeLock(s);
+    while (s->left.load() != nullptr) {
+        CNode *next = s->left.load();
+        writeLock(next);
+        if (sp != n) {
+            writeUnlock(sp);
+        }
+        sp = s;
+        s = next;
+    }
+    CNode *c = s->right.load();
+    if (c != nullptr) {
+        writeLock(c);
+    }
+    // release: a reader whose relaxed load sees the new key also sees the lock taken before it
+    n->element.store(s->element.load(memory_order_relaxed), memory_order_release);
+    if (sp == n) {
+        n->right.store(c);
+    } else {
+        sp->left.store(c);
+    }
+    if (c != nullptr) {
+        c->parent.store(sp);
+        writeUnlock(c);
+    }
+    writeUnlockObsolete(s);
+    epochs.retire(s, deleteNode);
+    if (sp != n) {
+        writeUnlock(sp);
+    }
+    writeUnlock(n);
+    rebalance(sp);
+}
+
+// private replaceChild: p must be locked
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::replaceChild(CNode * p, CNode * oldChild, CNode * newChild) {
+    if (p->left.load() == oldChild) {
+        p->left.store(newChild);
+    } else {
+        p->right.store(newChild);
+    }
+}
+
+// private lockParentOf: lock the current parent of t, re-reading it if a rotation moved t meanwhile.
+// Returns nullptr when t itself has been unlinked.
+template <typename Comparable>
+typename ConcurrentAVLTree<Comparable>::CNode * ConcurrentAVLTree<Comparable>::lockParentOf(CNode * t) {
+    while (true) {
+        if (t->version.load() & OBSOLETE) {
+            return nullptr;
+        }
+        CNode *p = t->parent.load();
+        writeLock(p);
+        if (!(p->version.load() & OBSOLETE) && t->parent.load() == p && (p->left.load() == t || p->right.load() == t)) {
+            return p;
+        }
+        writeUnlock(p);
+    }
+}
+
+// private rebalance: walk up from t fixing heights and rotating where the AVL condition is broken.
+// Each step locks parent, node and the child(ren) being rotated, top-down, and releases them before moving on.
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::rebalance(CNode * t) {
+    while (t != holder) {
+        CNode *p = lockParentOf(t);
+        if (p == nullptr) {
+            return;     // t was removed; whoever removed it rebalances from its parent
+        }
+        writeLock(t);
+        if (t->version.load() & OBSOLETE) {
+            writeUnlock(t);
+            writeUnlock(p);
+            return;
+        }
+
+        CNode *l = t->left.load();
+        CNode *r = t->right.load();
+        int imbalance = height(l) - height(r);
+        if (imbalance > ALLOWED_IMBALANCE) {
+            writeLock(l);
+            if (height(l->left.load()) >= height(l->right.load())) {
+                rotateWithLeftChild(p, t);
+                writeUnlock(l);
+            } else {
+                CNode *lr = l->right.load();
+                writeLock(lr);
+                rotateWithRightChild(t, l);     // t is locked and plays the parent's role here
+                rotateWithLeftChild(p, t);
+                writeUnlock(lr);
+                writeUnlock(l);
+            }
+        } else if (imbalance < -ALLOWED_IMBALANCE) {
+            writeLock(r);
+            if (height(r->right.load()) >= height(r->left.load())) {
+                rotateWithRightChild(p, t);
+                writeUnlock(r);
+            } else {
+                CNode *rl = r->left.load();
+                writeLock(rl);
+                rotateWithLeftChild(t, r);
+                rotateWithRightChild(p, t);
+                writeUnlock(rl);
+                writeUnlock(r);
+            }
+        } else {
+            int newHeight = 1 + max(height(l), height(r));
+            if (newHeight == height(t)) {
+                writeUnlock(t);
+                writeUnlock(p);
+                return;     // nothing above can change
+            }
+            t->height.store(newHeight, memory_order_relaxed);
+        }
+        writeUnlock(t);
+        writeUnlock(p);
+        t = p;
+    }
+}
+
+// private rotateWithLeftChild: k2's left child k1 replaces k2 under p; p, k2 and k1 are locked
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::rotateWithLeftChild(CNode * p, CNode * k2) {
+    CNode *k1 = k2->left.load();
+    CNode *b = k1->right.load();
+    k2->left.store(b);
+    if (b != nullptr) {
+        b->parent.store(k2);
+    }
+    k1->right.store(k2);
+    k2->parent.store(k1);
+    replaceChild(p, k2, k1);
+    k1->parent.store(p);
+    update(k2);
+    update(k1);
+}
+
+// private rotateWithRightChild: mirror image
+template <typename Comparable>
+void ConcurrentAVLTree<Comparable>::rotateWithRightChild(CNode * p, CNode * k2) {
+    CNode *k1 = k2->right.load();
+    CNode *b = k1->left.load();
+    k2->right.store(b);
+    if (b != nullptr) {
+        b->parent.store(k2);
+    }
+    k1->left.store(k2);
+    k2->parent.store(k1);
+    replaceChild(p, k2, k1);
+    k1->parent.store(p);
+    update(k2);
+    update(k1);
+}
+
+// private treeSize
+template <typename Comparable>
+int ConcurrentAVLTree<Comparable>::treeSize(CNode * t) const {
+    if (t == nullptr) {
+        return 0;
+    }
+    return 1 + treeSize(t->left.load()) + treeSize(t->right.load());
+}
+
+// private computeHeight
+template <typename Comparable>
+int ConcurrentAVLTree<Comparable>::computeHeight(CNode * t) const {
+    if (t == nullptr) {
+        return -1;
+    }
+    return 1 + max(computeHeight(t->left.load()), computeHeight(t->right.load()));
+}
+
+// private isBalanced: also checks that the cached heights are exact
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::isBalanced(CNode * t) const {
+    if (t == nullptr) {
+        return true;
+    }
+    CNode *l = t->left.load();
+    CNode *r = t->right.load();
+    return abs(height(l) - height(r)) <= ALLOWED_IMBALANCE && height(t) == 1 + max(height(l), height(r))
+        && isBalanced(l) && isBalanced(r);
+}
+
+// private isBST: lo/hi are exclusive bounds, nullptr for unbounded
+template <typename Comparable>
+bool ConcurrentAVLTree<Comparable>::isBST(CNode * t, const Comparable * lo, const Comparable * hi) const {
+    if (t == nullptr) {
+        return true;
+    }
+    Comparable key = t->element.load();
+    if ((lo != nullptr && !(*lo < key)) || (hi != nullptr && !(key < *hi))) {
+        return false;
+    }
+    CNode *p = t->left.load();
+    CNode *q = t->right.load();
+    return (p == nullptr || p->parent.load() == t) && (q == nullptr || q->parent.load() == t)
+        && isBST(p, lo, &key) && isBST(q, &key, hi);
+}
+
+#endif
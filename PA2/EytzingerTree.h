@@ -0,0 +1,135 @@
+#ifndef EytzingerTree_H
+#define EytzingerTree_H
+
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+using namespace std;
+
+// Immutable search structure in Eytzinger (BFS) order: the node at index k has children 2k and 2k+1,
+// so the top levels of every search share the same few cache lines and the walk needs no pointers.
+// Built from an already sorted, duplicate-free sequence, e.g. by AVLTree::freeze().
+// Searches are branchless and prefetch the cache line holding the descendants log2(BLOCK) levels down.
+template <typename Comparable>
+class EytzingerTree
+{
+private:
+    vector<Comparable> items;   // items[0] is unused so that the root sits at index 1
+    size_t n;
+
+    // elements per 64-byte cache line. The descendants of k that are d levels down are the 2^d nodes
+    // starting at index 2^d * k, so the BLOCK of them log2(BLOCK) levels down start at BLOCK * k: 16
+    // four levels down for 4-byte items, 8 three levels down for 8-byte ones. That is one whole line
+    // when sizeof(Comparable) is a power of two and the line is aligned; otherwise only approximately
+    static const size_t BLOCK = (sizeof(Comparable) < 64) ? 64 / sizeof(Comparable) : 1;
+
+    template <typename Iterator>
+    void build(Iterator & it, Iterator last, size_t k);
+    size_t lowerBoundIndex(const Comparable & x) const;
+
+public:
+    EytzingerTree() : items(1), n(0) {}
+
+    // first..last must be sorted in ascending order without duplicates and hold exactly count items;
+    // a different number of items throws invalid_argument
+    template <typename Iterator>
+    EytzingerTree(Iterator first, Iterator last, size_t count);
+
+    bool contains(const Comparable & x) const;
+    const Comparable * lower_bound(const Comparable & x) const;   // nullptr if every element < x
+
+    // answers queries in groups that walk the tree in lock step, so their cache misses overlap
+    void containsBatch(const vector<Comparable> & queries, vector<char> & results) const;
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    size_t memoryBytes() const { return items.capacity() * sizeof(Comparable); }
+};
+
+// constructor: an in-order walk over the implicit tree consumes the sorted input in order
+template <typename Comparable>
+template <typename Iterator>
+EytzingerTree<Comparable>::EytzingerTree(Iterator first, Iterator last, size_t count) : items(count + 1), n(count) {
+    build(first, last, 1);
+    if (first != last) {
+        throw invalid_argument("EytzingerTree: input holds more than count items");
+    }
+}
+
+// private build
+template <typename Comparable>
+template <typename Iterator>
+void EytzingerTree<Comparable>::build(Iterator & it, Iterator last, size_t k) {
+    if (k <= n) {
+        build(it, last, 2 * k);
+        if (it == last) {
+            throw invalid_argument("EytzingerTree: input holds fewer than count items");
+        }
+        items[k] = *it;
+        ++it;
+        build(it, last, 2 * k + 1);
+    }
+}
+
+// private lowerBoundIndex: go right whenever items[k] < x, then undo the trailing right turns
+// (plus the final left turn) to land on the last node where we went left; 0 means none
+template <typename Comparable>
+size_t EytzingerTree<Comparable>::lowerBoundIndex(const Comparable & x) const {
+    const Comparable *base = items.data();
+    size_t k = 1;
+    while (k <= n) {
+        __builtin_prefetch(base + k * BLOCK);
+        k = 2 * k + (base[k] < x);
+    }
+    k >>= __builtin_ffsll(~k);
+    return k;
+}
+
+// public contains
+template <typename Comparable>
+bool EytzingerTree<Comparable>::contains(const Comparable & x) const {
+    size_t k = lowerBoundIndex(x);
+    return k != 0 && !(x < items[k]);
+}
+
+// public lower_bound
+template <typename Comparable>
+const Comparable * EytzingerTree<Comparable>::lower_bound(const Comparable & x) const {
+    size_t k = lowerBoundIndex(x);
+    return (k == 0) ? nullptr : &items[k];
+}
+
+// public containsBatch
+template <typename Comparable>
+void EytzingerTree<Comparable>::containsBatch(const vector<Comparable> & queries, vector<char> & results) const {
+    const size_t GROUP = 16;
+    const Comparable *base = items.data();
+    results.resize(queries.size());
+
+    size_t q = 0;
+    for (; q + GROUP <= queries.size(); q += GROUP) {
+        size_t k[GROUP];
+        for (size_t g = 0; g < GROUP; g++) {
+            k[g] = 1;
+        }
+        // one pass per level of the tree; searches that already fell off the bottom just idle
+        for (size_t level = 1; level <= n; level *= 2) {
+            for (size_t g = 0; g < GROUP; g++) {
+                if (k[g] <= n) {
+                    __builtin_prefetch(base + k[g] * BLOCK);
+                    k[g] = 2 * k[g] + (base[k[g]] < queries[q + g]);
+                }
+            }
+        }
+        for (size_t g = 0; g < GROUP; g++) {
+            size_t j = k[g] >> __builtin_ffsll(~k[g]);
+            results[q + g] = (j != 0 && !(queries[q + g] < base[j]));
+        }
+    }
+    for (; q < queries.size(); q++) {
+        results[q] = contains(queries[q]);
+    }
+}
+
+#endif
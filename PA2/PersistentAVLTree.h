@@ -0,0 +1,293 @@
+#ifndef PersistentAVLTree_H
+#define PersistentAVLTree_H
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+// Persistent (path-copying) AVL tree. Nodes are immutable once built, so insert/remove copy
+// only the O(log n) nodes on the search path and share every other subtree with older versions.
+// Nodes are reference counted with shared_ptr and freed when the last version using them goes away.
+//
+// One writer at a time (writers are serialized by a mutex); any number of readers may call
+// snapshot() from other threads and traverse the returned Snapshot without taking any lock.
+// findMin/findMax on the tree itself return a copy, since the next insert/remove may free the node;
+// Snapshot::findMin/findMax return references that stay valid as long as the Snapshot.
+template <typename Comparable>
+class PersistentAVLTree
+{
+private:
+    struct PNode
+    {
+        const Comparable element;
+        const shared_ptr<const PNode> left;
+        const shared_ptr<const PNode> right;
+        const int height;
+
+        PNode( const Comparable & theElement, const shared_ptr<const PNode> & lt, const shared_ptr<const PNode> & rt )
+            : element(theElement), left(lt), right(rt), height(1 + max(nodeHeight(lt), nodeHeight(rt))) {}
+    };
+    typedef shared_ptr<const PNode> NodePtr;
+
+    NodePtr root;        // only read/written through atomic_load/atomic_store
+    mutex writeLock;
+
+    static int nodeHeight(const NodePtr & t) { return (t == nullptr) ? -1 : t->height; }
+    static NodePtr makeNode(const Comparable & x, const NodePtr & l, const NodePtr & r);
+    static NodePtr balance(const Comparable & x, const NodePtr & l, const NodePtr & r);
+    static NodePtr insert(const Comparable & x, const NodePtr & t);
+    static NodePtr remove(const Comparable & x, const NodePtr & t);
+    static NodePtr removeMin(const NodePtr & t);
+    static const PNode * findMin(const PNode * t);
+    static const PNode * findMax(const PNode * t);
+    static bool contains(const Comparable & x, const PNode * t);
+    static int treeSize(const PNode * t);
+    static bool isBalanced(const PNode * t);
+
+public:
+    // an immutable version of the tree; cheap to copy and safe to read from any thread
+    class Snapshot
+    {
+    public:
+        Snapshot() {}
+
+        bool contains(const Comparable & x) const { return PersistentAVLTree::contains(x, root.get()); }
+        const Comparable & findMin() const;
+        const Comparable & findMax() const;
+        bool empty() const { return root == nullptr; }
+        int treeSize() const { return PersistentAVLTree::treeSize(root.get()); }
+        int readRootHeight() const { return nodeHeight(root); }
+        bool isBalanced() const { return PersistentAVLTree::isBalanced(root.get()); }
+
+        // calls visit(node) on every node of this version, for sharing/memory measurements
+        template <typename Visitor>
+        void visitNodes(Visitor visit) const { visitNodes(root.get(), visit); }
+
+        static size_t nodeBytes() { return sizeof(PNode) + 2 * sizeof(void *); }   // node + shared_ptr control block
+
+    private:
+        NodePtr root;
+
+        explicit Snapshot(const NodePtr & r) : root(r) {}
+
+        template <typename Visitor>
+        static void visitNodes(const PNode * t, Visitor & visit);
+
+        friend class PersistentAVLTree<Comparable>;
+    };
+
+    PersistentAVLTree() {}
+
+    Snapshot snapshot() const;   // O(1): takes a reference to the current root
+
+    bool contains(const Comparable & x) const { return snapshot().contains(x); }
+    Comparable findMin() const { return snapshot().findMin(); }
+    Comparable findMax() const { return snapshot().findMax(); }
+    int treeSize() const { return snapshot().treeSize(); }
+    int readRootHeight() const { return snapshot().readRootHeight(); }
+    bool isBalanced() const { return snapshot().isBalanced(); }
+
+    void insert(const Comparable & x);
+    void remove(const Comparable & x);
+    void makeEmpty();
+
+    static const int ALLOWED_IMBALANCE = 1;
+};
+
+// private makeNode
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::NodePtr PersistentAVLTree<Comparable>::makeNode(const Comparable & x, const NodePtr & l, const NodePtr & r) {
+    return make_shared<const PNode>(x, l, r);
+}
+
+// private balance: builds the (possibly rotated) replacement for a node with element x and children l, r.
+// Same four cases as AVLTree::balance, but producing new nodes instead of relinking old ones.
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::NodePtr PersistentAVLTree<Comparable>::balance(const Comparable & x, const NodePtr & l, const NodePtr & r) {
+    if (nodeHeight(l) - nodeHeight(r) > ALLOWED_IMBALANCE) {
+        if (nodeHeight(l->left) >= nodeHeight(l->right)) {
+            return makeNode(l->element, l->left, makeNode(x, l->right, r));
+        }
+        const NodePtr & lr = l->right;
+        return makeNode(lr->element, makeNode(l->element, l->left, lr->left), makeNode(x, lr->right, r));
+    }
+    if (nodeHeight(r) - nodeHeight(l) > ALLOWED_IMBALANCE) {
+        if (nodeHeight(r->right) >= nodeHeight(r->left)) {
+            return makeNode(r->element, makeNode(x, l, r->left), r->right);
+        }
+        const NodePtr & rl = r->left;
+        return makeNode(rl->element, makeNode(x, l, rl->left), makeNode(r->element, rl->right, r->right));
+    }
+    return makeNode(x, l, r);
+}
+
+// private insert: returns t itself when x is already present, so unchanged paths are not copied
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::NodePtr PersistentAVLTree<Comparable>::insert(const Comparable & x, const NodePtr & t) {
+    if (t == nullptr) {
+        return makeNode(x, nullptr, nullptr);
+    }
+    if (x < t->element) {
+        NodePtr l = insert(x, t->left);
+        return (l == t->left) ? t : balance(t->element, l, t->right);
+    }
+    if (t->element < x) {
+        NodePtr r = insert(x, t->right);
+        return (r == t->right) ? t : balance(t->element, t->left, r);
+    }
+    return t;  // duplicate
+}
+
+// private remove
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::NodePtr PersistentAVLTree<Comparable>::remove(const Comparable & x, const NodePtr & t) {
+    if (t == nullptr) {
+        return t;
+    }
+    if (x < t->element) {
+        NodePtr l = remove(x, t->left);
+        return (l == t->left) ? t : balance(t->element, l, t->right);
+    }
+    if (t->element < x) {
+        NodePtr r = remove(x, t->right);
+        return (r == t->right) ? t : balance(t->element, t->left, r);
+    }
+    if (t->left == nullptr) {
+        return t->right;
+    }
+    if (t->right == nullptr) {
+        return t->left;
+    }
+    return balance(findMin(t->right.get())->element, t->left, removeMin(t->right));
+}
+
+// private removeMin
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::NodePtr PersistentAVLTree<Comparable>::removeMin(const NodePtr & t) {
+    if (t->left == nullptr) {
+        return t->right;
+    }
+    return balance(t->element, removeMin(t->left), t->right);
+}
+
+// private findMin
+template <typename Comparable>
+const typename PersistentAVLTree<Comparable>::PNode * PersistentAVLTree<Comparable>::findMin(const PNode * t) {
+    while (t != nullptr && t->left != nullptr) {
+        t = t->left.get();
+    }
+    return t;
+}
+
+// private findMax
+template <typename Comparable>
+const typename PersistentAVLTree<Comparable>::PNode * PersistentAVLTree<Comparable>::findMax(const PNode * t) {
+    while (t != nullptr && t->right != nullptr) {
+        t = t->right.get();
+    }
+    return t;
+}
+
+// private contains: plain pointer walk, no reference count traffic
+template <typename Comparable>
+bool PersistentAVLTree<Comparable>::contains(const Comparable & x, const PNode * t) {
+    while (t != nullptr) {
+        if (x < t->element) {
+            t = t->left.get();
+        } else if (t->element < x) {
+            t = t->right.get();
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// private treeSize
+template <typename Comparable>
+int PersistentAVLTree<Comparable>::treeSize(const PNode * t) {
+    if (t == nullptr) {
+        return 0;
+    }
+    return 1 + treeSize(t->left.get()) + treeSize(t->right.get());
+}
+
+// private isBalanced: uses the stored heights, which are fixed at construction
+template <typename Comparable>
+bool PersistentAVLTree<Comparable>::isBalanced(const PNode * t) {
+    if (t == nullptr) {
+        return true;
+    }
+    return abs(nodeHeight(t->left) - nodeHeight(t->right)) <= ALLOWED_IMBALANCE && isBalanced(t->left.get()) && isBalanced(t->right.get());
+}
+
+// Snapshot findMin
+template <typename Comparable>
+const Comparable & PersistentAVLTree<Comparable>::Snapshot::findMin() const {
+    if (root == nullptr) {
+        throw underflow_error("Tree is empty");
+    }
+    return PersistentAVLTree::findMin(root.get())->element;
+}
+
+// Snapshot findMax
+template <typename Comparable>
+const Comparable & PersistentAVLTree<Comparable>::Snapshot::findMax() const {
+    if (root == nullptr) {
+        throw underflow_error("Tree is empty");
+    }
+    return PersistentAVLTree::findMax(root.get())->element;
+}
+
+// Snapshot visitNodes
+template <typename Comparable>
+template <typename Visitor>
+void PersistentAVLTree<Comparable>::Snapshot::visitNodes(const PNode * t, Visitor & visit) {
+    if (t == nullptr) {
+        return;
+    }
+    visit(static_cast<const void *>(t));
+    visitNodes(t->left.get(), visit);
+    visitNodes(t->right.get(), visit);
+}
+
+// public snapshot
+template <typename Comparable>
+typename PersistentAVLTree<Comparable>::Snapshot PersistentAVLTree<Comparable>::snapshot() const {
+    return Snapshot(atomic_load(&root));
+}
+
+// public insert: build the new version off to the side, then publish it with one atomic store
+template <typename Comparable>
+void PersistentAVLTree<Comparable>::insert(const Comparable & x) {
+    lock_guard<mutex> guard(writeLock);
+    NodePtr current = atomic_load(&root);
+    NodePtr next = insert(x, current);
+    if (next != current) {
+        atomic_store(&root, next);
+    }
+}
+
+// public remove
+template <typename Comparable>
+void PersistentAVLTree<Comparable>::remove(const Comparable & x) {
+    lock_guard<mutex> guard(writeLock);
+    NodePtr current = atomic_load(&root);
+    NodePtr next = remove(x, current);
+    if (next != current) {
+        atomic_store(&root, next);
+    }
+}
+
+// public makeEmpty: older snapshots keep their nodes alive
+template <typename Comparable>
+void PersistentAVLTree<Comparable>::makeEmpty() {
+    lock_guard<mutex> guard(writeLock);
+    atomic_store(&root, NodePtr());
+}
+
+#endif
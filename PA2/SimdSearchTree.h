@@ -0,0 +1,270 @@
+#ifndef SimdSearchTree_H
+#define SimdSearchTree_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <climits>
+#include <stdexcept>
+#include <new>
+#include "AVLTree.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_SEARCH_X86 1
+#endif
+
+using namespace std;
+
+// Static k-ary search tree over int keys, in the spirit of FAST (Kim et al., SIGMOD 2010).
+// Every node is one 64-byte cache line holding 16 keys, so a lookup reads one line per level and
+// decides among 17 children with a couple of SIMD compares instead of four branchy binary steps.
+//
+// Level 0 is the sorted key array itself (padded with INT_MAX to whole blocks), so the leaf position
+// of a search is directly the rank of the key. Above it, key i of node j is the largest key under
+// child j * 17 + i, and child j * 17 + 16 takes everything else.
+//
+// The block compare is available as a scalar, an SSE2 and an AVX2 kernel; the constructor picks the
+// best one the CPU supports at run time, and setKernel() can override it for benchmarking.
+class SimdSearchTree
+{
+public:
+    enum Kernel { SCALAR_KERNEL, SSE2_KERNEL, AVX2_KERNEL };
+
+    // first..last must be sorted in ascending order without duplicates and hold exactly count items;
+    // a different number of items throws invalid_argument
+    template <typename Iterator>
+    SimdSearchTree(Iterator first, Iterator last, size_t count);
+    explicit SimdSearchTree(const AVLTree<int> & avl);
+    ~SimdSearchTree() { free(blocks); }
+
+    bool contains(int x) const;
+    size_t rank(int x) const;       // number of keys < x
+
+    size_t size() const { return n; }
+    size_t memoryBytes() const { return numBlocks * BLOCK * sizeof(int); }
+
+    Kernel kernel() const { return active; }
+    void setKernel(Kernel k);
+    static Kernel bestKernel();
+    static bool kernelSupported(Kernel k);
+    static const char * kernelName(Kernel k);
+
+private:
+    static const int BLOCK = 16;        // keys per node, one cache line of ints
+    static const int FANOUT = BLOCK + 1;
+
+    int *blocks;                        // all levels, 64-byte aligned; level 0 first
+    size_t numBlocks;
+    size_t n;
+    int maxKey;
+    vector<size_t> levelStart;          // first block of each level, leaves at index 0
+    Kernel active;
+
+    void build(const vector<int> & sorted);
+    const int * block(size_t level, size_t j) const { return blocks + (levelStart[level] + j) * BLOCK; }
+
+    size_t rankScalar(int x) const;
+#ifdef SIMD_SEARCH_X86
+    size_t rankSse2(int x) const;
+    size_t rankAvx2(int x) const;
+#endif
+
+    SimdSearchTree(const SimdSearchTree &);               // owns an aligned buffer, not copyable
+    SimdSearchTree & operator=(const SimdSearchTree &);
+};
+
+template <typename Iterator>
+SimdSearchTree::SimdSearchTree(Iterator first, Iterator last, size_t count) : blocks(nullptr), numBlocks(0), n(count), maxKey(INT_MIN) {
+    vector<int> sorted;
+    sorted.reserve(count);
+    for (; first != last; ++first) {
+        sorted.push_back(*first);
+    }
+    if (sorted.size() != count) {
+        throw invalid_argument("SimdSearchTree: input does not hold count items");
+    }
+    build(sorted);
+}
+
+inline SimdSearchTree::SimdSearchTree(const AVLTree<int> & avl) : blocks(nullptr), numBlocks(0), n(0), maxKey(INT_MIN) {
+    vector<int> sorted(avl.begin(), avl.end());
+    n = sorted.size();
+    build(sorted);
+}
+
+// private build: lay out the leaves, then each level of separators above them
+inline void SimdSearchTree::build(const vector<int> & sorted) {
+    vector<size_t> levelBlocks;
+    size_t count = (n + BLOCK - 1) / BLOCK;
+    if (count == 0) {
+        count = 1;
+    }
+    levelBlocks.push_back(count);
+    while (count > 1) {
+        count = (count + FANOUT - 1) / FANOUT;
+        levelBlocks.push_back(count);
+    }
+
+    numBlocks = 0;
+    for (size_t h = 0; h < levelBlocks.size(); h++) {
+        levelStart.push_back(numBlocks);
+        numBlocks += levelBlocks[h];
+    }
+    void *memory = nullptr;
+    if (posix_memalign(&memory, 64, numBlocks * BLOCK * sizeof(int)) != 0) {
+        throw bad_alloc();
+    }
+    blocks = static_cast<int *>(memory);
+
+    int *leaves = blocks;
+    for (size_t i = 0; i < levelBlocks[0] * BLOCK; i++) {
+        leaves[i] = (i < n) ? sorted[i] : INT_MAX;
+    }
+    maxKey = (n > 0) ? sorted[n - 1] : INT_MIN;
+
+    // a child at level h - 1 spans leavesPerChild leaf blocks; its largest key is the last one it covers
+    size_t leavesPerChild = 1;
+    for (size_t h = 1; h < levelBlocks.size(); h++) {
+        int *level = blocks + levelStart[h] * BLOCK;
+        for (size_t j = 0; j < levelBlocks[h]; j++) {
+            for (int i = 0; i < BLOCK; i++) {
+                size_t child = j * FANOUT + i;
+                size_t firstKey = child * leavesPerChild * BLOCK;
+                size_t endKey = (child + 1) * leavesPerChild * BLOCK;
+                level[j * BLOCK + i] = (firstKey < n) ? sorted[(endKey < n ? endKey : n) - 1] : INT_MAX;
+            }
+        }
+        leavesPerChild *= FANOUT;
+    }
+    active = bestKernel();
+}
+
+// public contains
+inline bool SimdSearchTree::contains(int x) const {
+    size_t r = rank(x);
+    return r < n && blocks[r] == x;
+}
+
+// public rank
+inline size_t SimdSearchTree::rank(int x) const {
+    if (n == 0 || x > maxKey) {
+        return n;
+    }
+    switch (active) {
+#ifdef SIMD_SEARCH_X86
+    case AVX2_KERNEL:
+        return rankAvx2(x);
+    case SSE2_KERNEL:
+        return rankSse2(x);
+#endif
+    default:
+        return rankScalar(x);
+    }
+}
+
+// private rankScalar: count the keys < x in each node; the count is the child to descend into
+inline size_t SimdSearchTree::rankScalar(int x) const {
+    size_t j = 0;
+    for (size_t h = levelStart.size() - 1; ; h--) {
+        const int *keys = block(h, j);
+        int c = 0;
+        for (int i = 0; i < BLOCK; i++) {
+            c += (keys[i] < x);
+        }
+        if (h == 0) {
+            return j * BLOCK + c;
+        }
+        j = j * FANOUT + c;
+    }
+}
+
+#ifdef SIMD_SEARCH_X86
+// private rankSse2: four 4-wide compares per node; each lane of a compare mask is 0 or -1
+__attribute__((target("sse2")))
+inline size_t SimdSearchTree::rankSse2(int x) const {
+    __m128i xv = _mm_set1_epi32(x);
+    size_t j = 0;
+    for (size_t h = levelStart.size() - 1; ; h--) {
+        const __m128i *keys = reinterpret_cast<const __m128i *>(block(h, j));
+        __m128i acc = _mm_cmpgt_epi32(xv, _mm_load_si128(keys));
+        acc = _mm_add_epi32(acc, _mm_cmpgt_epi32(xv, _mm_load_si128(keys + 1)));
+        acc = _mm_add_epi32(acc, _mm_cmpgt_epi32(xv, _mm_load_si128(keys + 2)));
+        acc = _mm_add_epi32(acc, _mm_cmpgt_epi32(xv, _mm_load_si128(keys + 3)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        int c = -_mm_cvtsi128_si32(acc);
+        if (h == 0) {
+            return j * BLOCK + c;
+        }
+        j = j * FANOUT + c;
+    }
+}
+
+// private rankAvx2: two 8-wide compares per node, counted with movemask + popcount
+__attribute__((target("avx2,popcnt")))
+inline size_t SimdSearchTree::rankAvx2(int x) const {
+    __m256i xv = _mm256_set1_epi32(x);
+    size_t j = 0;
+    for (size_t h = levelStart.size() - 1; ; h--) {
+        const __m256i *keys = reinterpret_cast<const __m256i *>(block(h, j));
+        __m256i lo = _mm256_cmpgt_epi32(xv, _mm256_load_si256(keys));
+        __m256i hi = _mm256_cmpgt_epi32(xv, _mm256_load_si256(keys + 1));
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(lo)) | (_mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8);
+        int c = __builtin_popcount(mask);
+        if (h == 0) {
+            return j * BLOCK + c;
+        }
+        j = j * FANOUT + c;
+    }
+}
+#endif
+
+// public setKernel
+inline void SimdSearchTree::setKernel(Kernel k) {
+    if (!kernelSupported(k)) {
+        throw invalid_argument("SimdSearchTree: kernel not supported on this CPU");
+    }
+    active = k;
+}
+
+// public kernelSupported
+inline bool SimdSearchTree::kernelSupported(Kernel k) {
+    switch (k) {
+    case SCALAR_KERNEL:
+        return true;
+#ifdef SIMD_SEARCH_X86
+    case SSE2_KERNEL:
+        return __builtin_cpu_supports("sse2");
+    case AVX2_KERNEL:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+    default:
+        return false;
+    }
+}
+
+// public bestKernel
+inline SimdSearchTree::Kernel SimdSearchTree::bestKernel() {
+    if (kernelSupported(AVX2_KERNEL)) {
+        return AVX2_KERNEL;
+    }
+    if (kernelSupported(SSE2_KERNEL)) {
+        return SSE2_KERNEL;
+    }
+    return SCALAR_KERNEL;
+}
+
+// public kernelName
+inline const char * SimdSearchTree::kernelName(Kernel k) {
+    switch (k) {
+    case AVX2_KERNEL:
+        return "AVX2";
+    case SSE2_KERNEL:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef TreeAggregates_H
+#define TreeAggregates_H
+
+#include <limits>
+#include <cstddef>
+
+using namespace std;
+
+// Aggregate policies for AVLTree<Comparable, Aggregate>. A policy describes a monoid over the elements:
+//     typedef ... value_type;
+//     static value_type identity();                                  // combine(identity(), a) == a
+//     static value_type lift(const Comparable & x);                  // the aggregate of a single element
+//     static value_type combine(const value_type & a, const value_type & b);   // associative, a before b
+// Every node then caches the combination over its subtree, so range queries only touch O(log n) nodes.
+// For map-like elements, write a policy whose lift() reads the value part of the element.
+
+// the default: nodes carry no aggregate and update() does no extra work
+struct NoAggregate
+{
+    typedef void value_type;
+};
+
+template <typename T>
+struct SumAggregate
+{
+    typedef T value_type;
+    static T identity() { return T(); }
+    static T lift(const T & x) { return x; }
+    static T combine(const T & a, const T & b) { return a + b; }
+};
+
+template <typename T>
+struct MinAggregate
+{
+    typedef T value_type;
+    static T identity() { return numeric_limits<T>::max(); }
+    static T lift(const T & x) { return x; }
+    static T combine(const T & a, const T & b) { return (b < a) ? b : a; }
+};
+
+template <typename T>
+struct MaxAggregate
+{
+    typedef T value_type;
+    static T identity() { return numeric_limits<T>::lowest(); }
+    static T lift(const T & x) { return x; }
+    static T combine(const T & a, const T & b) { return (a < b) ? b : a; }
+};
+
+template <typename T>
+struct CountAggregate
+{
+    typedef size_t value_type;
+    static size_t identity() { return 0; }
+    static size_t lift(const T &) { return 1; }
+    static size_t combine(size_t a, size_t b) { return a + b; }
+};
+
+// per-node storage for the aggregate; AVLNode derives from it, so with NoAggregate the empty
+// specialization adds no bytes to the node
+template <typename Aggregate>
+struct AggregateField
+{
+    typename Aggregate::value_type agg;
+
+    AggregateField() : agg(Aggregate::identity()) {}
+
+    // recompute t->agg from its children, which must already be up to date
+    template <typename Node>
+    static void pull(Node * t) {
+        typename Aggregate::value_type a = Aggregate::lift(t->element);
+        if (t->left != nullptr) {
+            a = Aggregate::combine(t->left->agg, a);
+        }
+        if (t->right != nullptr) {
+            a = Aggregate::combine(a, t->right->agg);
+        }
+        t->agg = a;
+    }
+};
+
+template <>
+struct AggregateField<NoAggregate>
+{
+    template <typename Node>
+    static void pull(Node *) {}
+};
+
+#endif
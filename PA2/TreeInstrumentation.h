@@ -0,0 +1,137 @@
+#ifndef TreeInstrumentation_H
+#define TreeInstrumentation_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Instrumentation policies for AVLTree<Comparable, Aggregate, Instrumentation, Balance>. The tree calls
+//     beginOperation(op), comparison(), rotation(isDouble), rebalanceStep(), endOperation()
+// around each contains/insert/remove, and AVLTree::stats() reads the per-operation rotation counts
+// back through snapshot(op). COUNTS says whether the policy keeps any.
+//     NoInstrumentation (the default)  empty inline hooks: an uninstrumented tree keeps no counters
+//     RotationInstrumentation          operations and rotations only, cheap enough for throughput runs
+//     CountingInstrumentation          also comparisons, rebalancing depth and their histograms
+
+enum TreeOperation { LOOKUP_OPERATION, INSERT_OPERATION, REMOVE_OPERATION, NUM_TREE_OPERATIONS };
+
+// totals and per-operation distributions for one kind of operation
+struct OperationCounters
+{
+    long long operations;
+    long long comparisons;
+    long long singleRotations;
+    long long doubleRotations;
+    long long rebalanceSteps;                // levels whose height changed or that were rotated
+    vector<long long> comparisonHistogram;   // [c] = operations that compared keys c times
+    vector<long long> rebalanceHistogram;    // [k] = operations whose rebalancing reached k levels
+
+    OperationCounters() : operations(0), comparisons(0), singleRotations(0), doubleRotations(0), rebalanceSteps(0) {}
+
+    double averageComparisons() const { return (operations > 0) ? static_cast<double>(comparisons) / operations : 0.0; }
+    double averageRotations() const { return (operations > 0) ? static_cast<double>(singleRotations + doubleRotations) / operations : 0.0; }
+    double averageRebalanceSteps() const { return (operations > 0) ? static_cast<double>(rebalanceSteps) / operations : 0.0; }
+};
+
+struct NoInstrumentation
+{
+    static const bool COUNTS = false;
+
+    void beginOperation(TreeOperation) {}
+    void comparison() {}
+    void rotation(bool) {}
+    void rebalanceStep() {}
+    void endOperation() {}
+
+    OperationCounters snapshot(TreeOperation) const { return OperationCounters(); }
+};
+
+// counts operations and single/double rotations per kind of operation; the other counters stay 0
+class RotationInstrumentation
+{
+public:
+    static const bool COUNTS = true;
+
+    RotationInstrumentation() : current(LOOKUP_OPERATION) {}
+
+    void beginOperation(TreeOperation op) { current = op; counters[op].operations++; }
+    void comparison() {}
+    void rotation(bool isDouble) {
+        if (isDouble) {
+            counters[current].doubleRotations++;
+        } else {
+            counters[current].singleRotations++;
+        }
+    }
+    void rebalanceStep() {}
+    void endOperation() {}
+
+    OperationCounters snapshot(TreeOperation op) const { return counters[op]; }
+    void reset() {
+        for (int op = 0; op < NUM_TREE_OPERATIONS; op++) {
+            counters[op] = OperationCounters();
+        }
+    }
+
+private:
+    OperationCounters counters[NUM_TREE_OPERATIONS];
+    TreeOperation current;
+};
+
+// not thread-safe, like the tree it instruments
+class CountingInstrumentation
+{
+public:
+    static const bool COUNTS = true;
+
+    CountingInstrumentation() : current(LOOKUP_OPERATION), comparisons(0), steps(0) {}
+
+    void beginOperation(TreeOperation op) { current = op; comparisons = 0; steps = 0; }
+    void comparison() { comparisons++; }
+    void rotation(bool isDouble) {
+        if (isDouble) {
+            counters[current].doubleRotations++;
+        } else {
+            counters[current].singleRotations++;
+        }
+    }
+    void rebalanceStep() { steps++; }
+    void endOperation();
+
+    // a copy of the counters so far, so later operations do not change it
+    OperationCounters snapshot(TreeOperation op) const { return counters[op]; }
+    void reset();
+
+private:
+    OperationCounters counters[NUM_TREE_OPERATIONS];
+    TreeOperation current;
+    long long comparisons;   // for the operation in progress
+    long long steps;
+
+    static void record(vector<long long> & histogram, long long value);
+};
+
+inline void CountingInstrumentation::endOperation() {
+    OperationCounters & c = counters[current];
+    c.operations++;
+    c.comparisons += comparisons;
+    c.rebalanceSteps += steps;
+    record(c.comparisonHistogram, comparisons);
+    record(c.rebalanceHistogram, steps);
+}
+
+inline void CountingInstrumentation::reset() {
+    for (int op = 0; op < NUM_TREE_OPERATIONS; op++) {
+        counters[op] = OperationCounters();
+    }
+}
+
+inline void CountingInstrumentation::record(vector<long long> & histogram, long long value) {
+    if (static_cast<long long>(histogram.size()) <= value) {
+        histogram.resize(value + 1, 0);
+    }
+    histogram[value]++;
+}
+
+#endif
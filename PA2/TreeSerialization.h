@@ -0,0 +1,188 @@
+#ifndef TreeSerialization_H
+#define TreeSerialization_H
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+// On-disk format used by AVLTree::save / load / loadMapped: a 16-byte header followed by the
+// elements in ascending order.
+//
+//     "AVLT"  version (1 byte)  encoding (1 byte)  sizeof(Comparable) (2 bytes)  count (8 bytes)
+//
+// Integral keys use DELTA_VARINT_ENCODING: each key is stored as the difference to the previous one
+// (the first one to 0), computed modulo 2^64 and written as a LEB128 varint, so dense key sets take
+// about one byte per key. Other trivially copyable types are stored as raw bytes. Multi-byte fields are
+// in host byte order; files are meant to be read back on the same kind of machine.
+
+enum TreeEncoding { RAW_ENCODING = 0, DELTA_VARINT_ENCODING = 1 };
+
+struct TreeFileHeader
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t encoding;
+    uint16_t keyBytes;
+    uint64_t count;
+};
+
+// buffers the output so that varints are not written one put() at a time; the owner must call
+// flush() when done, since a destructor cannot report a failed write
+class TreeFileWriter
+{
+public:
+    explicit TreeFileWriter(ostream & o) : out(o), used(0) {}
+
+    void put(uint8_t b) {
+        if (used == BUFFER_BYTES) {
+            flush();
+        }
+        buffer[used++] = static_cast<char>(b);
+    }
+    void write(const void * p, size_t n) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(p);
+        for (size_t i = 0; i < n; i++) {
+            put(bytes[i]);
+        }
+    }
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            put(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        put(static_cast<uint8_t>(v));
+    }
+    void flush() {
+        out.write(buffer, used);
+        used = 0;
+        if (!out) {
+            throw runtime_error("AVLTree::save: write failed");
+        }
+    }
+
+private:
+    static const size_t BUFFER_BYTES = 1 << 16;
+    ostream & out;
+    char buffer[BUFFER_BYTES];
+    size_t used;
+};
+
+// reads through a buffer refilled from an istream
+class TreeStreamReader
+{
+public:
+    explicit TreeStreamReader(istream & i) : in(i), buffer(1 << 16), pos(0), end(0) {}
+
+    uint8_t get() {
+        if (pos == end) {
+            in.read(&buffer[0], buffer.size());
+            end = static_cast<size_t>(in.gcount());
+            pos = 0;
+            if (end == 0) {
+                throw runtime_error("AVLTree::load: unexpected end of file");
+            }
+        }
+        return static_cast<uint8_t>(buffer[pos++]);
+    }
+    void read(void * p, size_t n) {
+        uint8_t *bytes = static_cast<uint8_t *>(p);
+        for (size_t i = 0; i < n; i++) {
+            bytes[i] = get();
+        }
+    }
+    uint64_t getVarint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = get();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (b < 0x80) {
+                return v;
+            }
+        }
+        throw runtime_error("AVLTree::load: malformed varint");
+    }
+
+private:
+    istream & in;
+    vector<char> buffer;
+    size_t pos;
+    size_t end;
+};
+
+// reads straight out of a memory-mapped file
+class TreeMemoryReader
+{
+public:
+    TreeMemoryReader(const uint8_t * begin, size_t size) : p(begin), end(begin + size) {}
+
+    uint8_t get() {
+        if (p == end) {
+            throw runtime_error("AVLTree::load: unexpected end of file");
+        }
+        return *p++;
+    }
+    void read(void * dst, size_t n) {
+        if (static_cast<size_t>(end - p) < n) {
+            throw runtime_error("AVLTree::load: unexpected end of file");
+        }
+        memcpy(dst, p, n);
+        p += n;
+    }
+    uint64_t getVarint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = get();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (b < 0x80) {
+                return v;
+            }
+        }
+        throw runtime_error("AVLTree::load: malformed varint");
+    }
+
+private:
+    const uint8_t *p;
+    const uint8_t *end;
+};
+
+// per-type element encoding; state carries the previous key for the delta coder
+template <typename Comparable, bool Integral = is_integral<Comparable>::value>
+struct TreeKeyCodec
+{
+    static_assert(is_trivially_copyable<Comparable>::value, "AVLTree::save/load need integral or trivially copyable elements");
+    static const TreeEncoding ENCODING = RAW_ENCODING;
+
+    static void encode(TreeFileWriter & w, const Comparable & x, uint64_t &) { w.write(&x, sizeof(Comparable)); }
+
+    template <typename Reader>
+    static Comparable decode(Reader & r, uint64_t &) {
+        Comparable x;
+        r.read(&x, sizeof(Comparable));
+        return x;
+    }
+};
+
+template <typename Comparable>
+struct TreeKeyCodec<Comparable, true>
+{
+    static const TreeEncoding ENCODING = DELTA_VARINT_ENCODING;
+
+    static void encode(TreeFileWriter & w, const Comparable & x, uint64_t & prev) {
+        uint64_t v = static_cast<uint64_t>(x);
+        w.putVarint(v - prev);
+        prev = v;
+    }
+
+    template <typename Reader>
+    static Comparable decode(Reader & r, uint64_t & prev) {
+        prev += r.getVarint();
+        return static_cast<Comparable>(prev);
+    }
+};
+
+#endif
@@ -1,14 +1,29 @@
 #include "AVLTree.h"
+#include "PersistentAVLTree.h"
+#include "BPlusTree.h"
+#include "SimdSearchTree.h"
+#include "ConcurrentAVLTree.h"
 #include "experimentFunctions.h"
+#include "../common/Workload.h"
+#include <omp.h>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <mutex>
 
 using namespace std;
 
+// Every experiment draws from common/Workload.h with fixed seeds, so runs are repeatable: key sets come
+// from generateKeys(), sequential streams from a WorkloadRng, and each thread gets its own
+// WorkloadRng::forIndex(seed, thread). All of experiment 2 draws from this one engine.
+static WorkloadRng experimentRng(2);
+
 double cLog2(double d)
 {
     return log(d) / log(2); // log() use e as base
 }
 
-void insertRandomIntegers(AVLTree<int>* avl, int numIntegers)
+void insertRandomIntegers(Experiment2Tree* avl, int numIntegers)
 {
     // The range of random integers
     const int minValue = -1000000000;
@@ -16,22 +31,20 @@ void insertRandomIntegers(AVLTree<int>* avl, int numIntegers)
     int randomInteger;
 
     // Generate a uniform distribution to generate random integers
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<std::mt19937::result_type> dist(minValue, maxValue); 
+    uniform_int_distribution<int> dist(minValue, maxValue); 
 
     // Generate random integers (without duplicates) from the specified range
+    // insert() reports duplicates itself, so each attempt is a single walk down the tree
     for (int i = 0; i < numIntegers; ++i) {
-        randomInteger = dist(rng);
-        while ( avl->contains(randomInteger) == true )
+        randomInteger = dist(experimentRng);
+        while ( avl->insert(randomInteger).second == false )
         {
-            randomInteger = dist(rng);
+            randomInteger = dist(experimentRng);
         }
-        avl->insert(randomInteger);
     }
 }
 
-void deleteRandomIntegers(AVLTree<int>* avl, int numDelete)
+void deleteRandomIntegers(Experiment2Tree* avl, int numDelete)
 {
     int treeSize = avl->treeSize();
     // The range of random integers for ranks in AVL
@@ -40,15 +53,12 @@ void deleteRandomIntegers(AVLTree<int>* avl, int numDelete)
     int randomInteger;
 
     // Generate a uniform distribution to generate random integers
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<std::mt19937::result_type> dist(minValue, maxValue); 
+    uniform_int_distribution<int> dist(minValue, maxValue); 
 
     // Randomly delete a node by its rank in AVL
     for (int i = 0; i < numDelete; i++) {
-        randomInteger = dist(rng);
+        randomInteger = dist(experimentRng);
         avl->removeByRank(randomInteger);
-        cout << "Inserted: " << randomInteger << endl;
     }
 }
 
@@ -60,6 +70,10 @@ bool testBalanced(AVLTree<int>* avl) {
     return avl->isBalanced();
 }
 
+bool testBalanced(Experiment2Tree* avl) {
+    return avl->isBalanced();
+}
+
 bool testContains(AVLTree<int>*avl, int numIntegers) {
     bool flag = 1;
     for (int i = 0; i < numIntegers; i++)
@@ -78,11 +92,11 @@ bool testContains(AVLTree<int>*avl, int numIntegers) {
     return flag;
 }
 
-bool testSize(AVLTree<int> * avl, int targetNumIntegers) {
+bool testSize(Experiment2Tree * avl, int targetNumIntegers) {
     return (avl->treeSize() == targetNumIntegers);
 }
 
-bool testHeight(AVLTree<int>* avl) {
+bool testHeight(Experiment2Tree* avl) {
     return (avl->readRootHeight() == avl->computeHeight());
 }
 
@@ -106,7 +120,7 @@ void experiment1(int numIntegers) {
         }
     }
     reverse(testValuesReversed.begin(), testValuesReversed.end());
-    auto rng = default_random_engine{};
+    WorkloadRng rng(1);
     shuffle(testValuesShuffled.begin(), testValuesShuffled.end(), rng);
 
     for (int i = 0; i < testValues.size(); i++)
@@ -148,7 +162,23 @@ void experiment1(int numIntegers) {
     delete tree3;
 }
 
-void stage1(AVLTree<int>* avl, int numIntegers) {
+void printOperationCounters(const char* label, const OperationCounters& counters) {
+    cout << "         " << label << ": " << counters.operations << " ops, per op: " << counters.averageComparisons() << " comparisons, "
+         << counters.averageRotations() << " rotations (" << counters.singleRotations << " single, " << counters.doubleRotations << " double in total), "
+         << counters.averageRebalanceSteps() << " rebalanced levels" << endl;
+    cout << "         " << label << " comparisons per op:";
+    for (size_t c = 0; c < counters.comparisonHistogram.size(); c++)
+        if (counters.comparisonHistogram[c] > 0)
+            cout << " " << c << ":" << counters.comparisonHistogram[c];
+    cout << endl;
+    cout << "         " << label << " rebalanced levels per op:";
+    for (size_t k = 0; k < counters.rebalanceHistogram.size(); k++)
+        if (counters.rebalanceHistogram[k] > 0)
+            cout << " " << k << ":" << counters.rebalanceHistogram[k];
+    cout << endl;
+}
+
+void stage1(Experiment2Tree* avl, int numIntegers) {
     // compute how many extra data we will insert into AVL compared with Figure 4.29 (500 nodes there) relatively
     double relativeSizeChangeFromTextbook = (numIntegers - 500.0) / 500.0;
 
@@ -179,10 +209,12 @@ void stage1(AVLTree<int>* avl, int numIntegers) {
         cout << (relativeChangeFromTextbookInitial*100) << "% greater" << endl;
     else
         cout << (-relativeChangeFromTextbookInitial*100) << "% less" << endl;
+
+    cout << "(EXP2.5a) Rebalancing work during stage 1 (duplicates drawn by the generator count as inserts too):" << endl;
+    printOperationCounters("insert", avl->counters().snapshot(INSERT_OPERATION));
 }
 
-void stage2(AVLTree<int>* avl, int numRandomInsertRemove) {
-    cout << "Checkpoint 1" << endl;
+void stage2(Experiment2Tree* avl, int numRandomInsertRemove) {
     // use treeSize() to compute how many extra data we will insert into AVL compared with Figure 4.29 (500 nodes there) relatively
     int numIntegers = avl->treeSize();
     double relativeSizeChangeFromTextbook = ( numIntegers - 500.0 ) / 500.0;
@@ -190,19 +222,16 @@ void stage2(AVLTree<int>* avl, int numRandomInsertRemove) {
     // use averageDepth() to compute what is the initial average depth before stage 2
     double averageDepth = avl->averageDepth();
 
-    cout << "Checkpoint 2" << endl;
+    // count only the work of stage 2
+    avl->counters().reset();
 
     auto start = chrono::high_resolution_clock::now();
 
-    cout << "Checkpoint 3" << endl;
-
     for (int i=0; i<numRandomInsertRemove; i++) {
         insertRandomIntegers(avl, 1);
         deleteRandomIntegers(avl, 1);
     }
 
-    cout << "Checkpoint 4" << endl;
-
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double, milli> duration = end - start;
     
@@ -241,4 +270,863 @@ void stage2(AVLTree<int>* avl, int numRandomInsertRemove) {
         if (-relativeChangeFromTextbook > 0.1)
             cout << "           ==> my AVL tree improves the average depth over BST significantly (>10%)" << endl;
     }
+    // single O(n) pass over every invariant, cheap enough for trees with millions of nodes
+    const char* reason = nullptr;
+    bool valid = avl->validate(&reason);
+    cout << "(EXP2.11) validate(): " << valid;
+    if (!valid)
+        cout << " (" << reason << ")";
+    cout << endl;
+    avl->printStats(cout);
+
+    cout << "(EXP2.12) Rebalancing work during stage 2:" << endl;
+    printOperationCounters("insert", avl->counters().snapshot(INSERT_OPERATION));
+    printOperationCounters("remove", avl->counters().snapshot(REMOVE_OPERATION));
+}
+
+bool testIterators(AVLTree<int>* avl, const vector<int>& sorted) {
+    // forward iteration visits exactly the sorted sequence
+    size_t i = 0;
+    for (AVLTree<int>::const_iterator it = avl->begin(); it != avl->end(); ++it, ++i) {
+        if (i >= sorted.size() || *it != sorted[i])
+            return false;
+    }
+    if (i != sorted.size())
+        return false;
+
+    // backward iteration from end()
+    AVLTree<int>::const_iterator it = avl->end();
+    for (size_t j = sorted.size(); j > 0; j--) {
+        --it;
+        if (*it != sorted[j - 1])
+            return false;
+    }
+
+    // lower_bound / upper_bound agree with std:: on present and missing keys
+    for (size_t j = 0; j < sorted.size(); j += 1 + sorted.size() / 64) {
+        for (int x = sorted[j] - 1; x <= sorted[j] + 1; x++) {
+            vector<int>::const_iterator lb = std::lower_bound(sorted.begin(), sorted.end(), x);
+            vector<int>::const_iterator ub = std::upper_bound(sorted.begin(), sorted.end(), x);
+            AVLTree<int>::const_iterator alb = avl->lower_bound(x);
+            AVLTree<int>::const_iterator aub = avl->upper_bound(x);
+            if ((lb == sorted.end()) != (alb == avl->end()) || (lb != sorted.end() && *lb != *alb))
+                return false;
+            if ((ub == sorted.end()) != (aub == avl->end()) || (ub != sorted.end() && *ub != *aub))
+                return false;
+        }
+    }
+    return true;
+}
+
+void experiment3(int numIntegers, int numRangeQueries, int rangeWidth) {
+    AVLTree<int>* avl = new AVLTree<int>();
+
+    // even keys in random order, so odd query bounds fall between keys
+    vector<int> sorted;
+    for (int i = 0; i < numIntegers; i++)
+        sorted.push_back(2 * i);
+    vector<int> shuffled(sorted);
+    WorkloadRng rng(3);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+    for (size_t i = 0; i < shuffled.size(); i++)
+        avl->insert(shuffled[i]);
+
+    cout << "(EXP3.1) Iterators and lower/upper bound match sorted order: " << testIterators(avl, sorted) << endl;
+
+    vector<int> starts;
+    uniform_int_distribution<int> dist(0, 2 * numIntegers);
+    for (int i = 0; i < numRangeQueries; i++)
+        starts.push_back(dist(rng));
+
+    // sum every key in [lo, lo + 2 * rangeWidth] three ways; checksums must agree
+    long long sumVisit = 0, sumIter = 0, sumArray = 0;
+    long long visited = 0;
+
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t q = 0; q < starts.size(); q++) {
+        avl->rangeVisit(starts[q], starts[q] + 2 * rangeWidth, [&](int x) { sumVisit += x; visited++; });
+    }
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> visitTime = end - start;
+
+    start = chrono::high_resolution_clock::now();
+    for (size_t q = 0; q < starts.size(); q++) {
+        int hi = starts[q] + 2 * rangeWidth;
+        for (AVLTree<int>::const_iterator it = avl->lower_bound(starts[q]); it != avl->end() && *it <= hi; ++it)
+            sumIter += *it;
+    }
+    end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> iterTime = end - start;
+
+    start = chrono::high_resolution_clock::now();
+    for (size_t q = 0; q < starts.size(); q++) {
+        int hi = starts[q] + 2 * rangeWidth;
+        for (vector<int>::const_iterator it = std::lower_bound(sorted.begin(), sorted.end(), starts[q]); it != sorted.end() && *it <= hi; ++it)
+            sumArray += *it;
+    }
+    end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> arrayTime = end - start;
+
+    cout << "(EXP3.2) " << numRangeQueries << " range scans of width " << rangeWidth << " over " << numIntegers << " keys (" << visited << " keys reported)" << endl;
+    cout << "         rangeVisit():          " << visitTime.count() << " ms" << endl;
+    cout << "         lower_bound() + ++it:  " << iterTime.count() << " ms" << endl;
+    cout << "         sorted vector:         " << arrayTime.count() << " ms" << endl;
+    cout << "         checksums agree? " << (sumVisit == sumIter && sumIter == sumArray) << endl;
+
+    delete avl;
+}
+
+// fill two trees with numIntegers distinct keys each from [0, 4 * numIntegers), so they overlap by roughly a quarter
+static void buildSetOperands(AVLTree<int>* a, AVLTree<int>* b, vector<int>& sortedA, vector<int>& sortedB, int numIntegers) {
+    vector<int> keys;
+    for (int i = 0; i < 4 * numIntegers; i++)
+        keys.push_back(i);
+    WorkloadRng rng(4);
+    shuffle(keys.begin(), keys.end(), rng);
+    sortedA.assign(keys.begin(), keys.begin() + numIntegers);
+    shuffle(keys.begin(), keys.end(), rng);
+    sortedB.assign(keys.begin(), keys.begin() + numIntegers);
+    for (int i = 0; i < numIntegers; i++) {
+        a->insert(sortedA[i]);
+        b->insert(sortedB[i]);
+    }
+    sort(sortedA.begin(), sortedA.end());
+    sort(sortedB.begin(), sortedB.end());
+}
+
+static bool sameKeys(AVLTree<int>* avl, const vector<int>& expected) {
+    return testIterators(avl, expected) && avl->isBalanced();
+}
+
+void experiment4(int numIntegers) {
+    vector<int> sortedA, sortedB, expected;
+
+    // baseline: the only option before join/split, inserting one tree into the other element by element
+    AVLTree<int>* a = new AVLTree<int>();
+    AVLTree<int>* b = new AVLTree<int>();
+    buildSetOperands(a, b, sortedA, sortedB, numIntegers);
+    auto start = chrono::high_resolution_clock::now();
+    for (AVLTree<int>::const_iterator it = b->begin(); it != b->end(); ++it)
+        a->insert(*it);
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> insertTime = end - start;
+    delete a;
+    delete b;
+
+    set_union(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), back_inserter(expected));
+    cout << "(EXP4.1) Union of two " << numIntegers << "-key trees by repeated insert: " << insertTime.count() << " ms" << endl;
+
+    int maxThreads = omp_get_max_threads();
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        int threads = threadCounts[t];
+        omp_set_num_threads(threads);
+        double times[3] = {0, 0, 0};
+        bool correct[3];
+        for (int op = 0; op < 3; op++) {
+            a = new AVLTree<int>();
+            b = new AVLTree<int>();
+            buildSetOperands(a, b, sortedA, sortedB, numIntegers);
+            expected.clear();
+            start = chrono::high_resolution_clock::now();
+            if (op == 0) {
+                a->unionWith(*b);
+            } else if (op == 1) {
+                a->intersectWith(*b);
+            } else {
+                a->differenceWith(*b);
+            }
+            end = chrono::high_resolution_clock::now();
+            times[op] = chrono::duration<double, milli>(end - start).count();
+
+            if (op == 0)
+                set_union(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), back_inserter(expected));
+            else if (op == 1)
+                set_intersection(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), back_inserter(expected));
+            else
+                set_difference(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), back_inserter(expected));
+            correct[op] = sameKeys(a, expected);
+            delete a;
+            delete b;
+        }
+        cout << "(EXP4.2) " << threads << " thread(s): union " << times[0] << " ms, intersection " << times[1]
+             << " ms, difference " << times[2] << " ms; correct? " << (correct[0] && correct[1] && correct[2]) << endl;
+    }
+    omp_set_num_threads(maxThreads);
+
+    // split and join back together
+    a = new AVLTree<int>();
+    b = new AVLTree<int>();
+    buildSetOperands(a, b, sortedA, sortedB, numIntegers);
+    AVLTree<int> lower, upper;
+    int pivot = sortedA[sortedA.size() / 3];
+    bool found = a->split(pivot, lower, upper);
+    bool splitOk = found && lower.findMax() < pivot && pivot < upper.findMin() && lower.isBalanced() && upper.isBalanced();
+    a->join(lower, pivot, upper);
+    cout << "(EXP4.3) split() then join() restores the tree: " << (splitOk && sameKeys(a, sortedA)) << endl;
+    delete a;
+    delete b;
+}
+
+// readers take a snapshot, run a batch of lookups on it, and repeat until told to stop
+static void snapshotReaders(PersistentAVLTree<int>* tree, int numReaders, int keyRange, bool withWriter, double& lookupsPerSecond) {
+    atomic<bool> stop(false);
+    atomic<long long> lookups(0);
+    vector<thread> readers;
+    for (int r = 0; r < numReaders; r++) {
+        readers.push_back(thread([&, r]() {
+            WorkloadRng rng = WorkloadRng::forIndex(1000, r);   // one independent stream per reader
+            uniform_int_distribution<int> dist(0, keyRange - 1);
+            long long local = 0, hits = 0;
+            while (!stop.load()) {
+                PersistentAVLTree<int>::Snapshot snap = tree->snapshot();
+                for (int i = 0; i < 1000; i++)
+                    hits += snap.contains(dist(rng));
+                local += 1000;
+            }
+            lookups += local + (hits < 0);   // keep the lookups from being optimized away
+        }));
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    if (withWriter) {
+        WorkloadRng rng(7);
+        uniform_int_distribution<int> dist(0, keyRange - 1);
+        while (chrono::high_resolution_clock::now() - start < chrono::milliseconds(500)) {
+            tree->insert(dist(rng));
+            tree->remove(dist(rng));
+        }
+    } else {
+        this_thread::sleep_for(chrono::milliseconds(500));
+    }
+    stop = true;
+    for (size_t r = 0; r < readers.size(); r++)
+        readers[r].join();
+    auto end = chrono::high_resolution_clock::now();
+    lookupsPerSecond = lookups.load() / chrono::duration<double>(end - start).count();
+}
+
+void experiment5(int numIntegers, int numSnapshots, int numReaders) {
+    vector<int> keys;
+    for (int i = 0; i < numIntegers; i++)
+        keys.push_back(2 * i);
+    WorkloadRng rng(5);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    PersistentAVLTree<int>* tree = new PersistentAVLTree<int>();
+    AVLTree<int>* avl = new AVLTree<int>();
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numIntegers; i++)
+        tree->insert(keys[i]);
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> persistentInsert = end - start;
+    start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numIntegers; i++)
+        avl->insert(keys[i]);
+    end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> avlInsert = end - start;
+    cout << "(EXP5.1) Insert " << numIntegers << " keys: persistent " << persistentInsert.count() << " ms, AVLTree " << avlInsert.count() << " ms" << endl;
+    cout << "         persistent tree balanced? " << tree->isBalanced() << "; size: " << tree->treeSize() << endl;
+
+    // snapshot cost vs the stop-the-world alternative of copying the tree
+    start = chrono::high_resolution_clock::now();
+    long long sink = 0;
+    for (int i = 0; i < numSnapshots; i++)
+        sink += tree->snapshot().readRootHeight();
+    end = chrono::high_resolution_clock::now();
+    double snapshotNs = chrono::duration<double, nano>(end - start).count() / numSnapshots;
+    start = chrono::high_resolution_clock::now();
+    AVLTree<int>* copy = new AVLTree<int>();
+    for (AVLTree<int>::const_iterator it = avl->begin(); it != avl->end(); ++it)
+        copy->insert(*it);
+    end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> copyTime = end - start;
+    delete copy;
+    cout << "(EXP5.2) snapshot(): " << snapshotNs << " ns each (" << (sink > 0) << "); copying the AVLTree instead: " << copyTime.count() << " ms" << endl;
+
+    // memory: keep one snapshot per batch of updates and count the distinct nodes they hold
+    WorkloadRng updates(11);
+    uniform_int_distribution<int> dist(0, 2 * numIntegers - 1);
+    vector<PersistentAVLTree<int>::Snapshot> versions;
+    int updatesPerVersion = 100;
+    for (int v = 0; v < 10; v++) {
+        versions.push_back(tree->snapshot());
+        for (int i = 0; i < updatesPerVersion; i++) {
+            tree->insert(dist(updates));
+            tree->remove(dist(updates));
+        }
+    }
+    unordered_set<const void*> distinct;
+    long long unshared = 0;
+    for (size_t v = 0; v < versions.size(); v++) {
+        versions[v].visitNodes([&](const void* node) { distinct.insert(node); unshared++; });
+    }
+    size_t nodeBytes = PersistentAVLTree<int>::Snapshot::nodeBytes();
+    cout << "(EXP5.3) " << versions.size() << " versions, " << updatesPerVersion << " insert/remove pairs apart: "
+         << distinct.size() << " distinct nodes vs " << unshared << " if copied ("
+         << (100.0 * distinct.size() / unshared) << "%)" << endl;
+    cout << "         bytes/node: persistent ~" << nodeBytes << " (incl. refcount block), AVLTree " << AVLTree<int>::nodeBytes() << endl;
+    versions.clear();
+
+    // reader throughput with and without a concurrent writer
+    double idleRate, busyRate;
+    snapshotReaders(tree, numReaders, 2 * numIntegers, false, idleRate);
+    snapshotReaders(tree, numReaders, 2 * numIntegers, true, busyRate);
+    cout << "(EXP5.4) " << numReaders << " lock-free reader(s): " << (idleRate / 1e6) << " M lookups/s alone, "
+         << (busyRate / 1e6) << " M lookups/s with a concurrent writer" << endl;
+    cout << "         balanced after concurrent updates? " << tree->isBalanced() << endl;
+
+    delete tree;
+    delete avl;
+}
+
+// runs the same insert/lookup/range-scan/remove workload on any tree with the AVLTree interface
+// and prints Mops/s for each phase; returns a checksum so trees can be compared
+template <typename Tree>
+static long long orderedSetWorkload(const string& name, Tree* tree, const vector<int>& keys, const vector<int>& queries,
+                                    const vector<int>& rangeStarts, int rangeWidth) {
+    long long checksum = 0;
+
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        tree->insert(keys[i]);
+    auto end = chrono::high_resolution_clock::now();
+    double insertSec = chrono::duration<double>(end - start).count();
+
+    start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < queries.size(); i++)
+        checksum += tree->contains(queries[i]);
+    end = chrono::high_resolution_clock::now();
+    double lookupSec = chrono::duration<double>(end - start).count();
+
+    long long scanned = 0;
+    start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < rangeStarts.size(); i++)
+        tree->rangeVisit(rangeStarts[i], rangeStarts[i] + rangeWidth, [&](int x) { checksum += x; scanned++; });
+    end = chrono::high_resolution_clock::now();
+    double scanSec = chrono::duration<double>(end - start).count();
+
+    checksum += tree->treeSize() + tree->findMin() + tree->findMax();
+
+    start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < keys.size(); i += 2)
+        tree->remove(keys[i]);
+    end = chrono::high_resolution_clock::now();
+    double removeSec = chrono::duration<double>(end - start).count();
+    checksum += tree->treeSize();
+
+    cout << "         " << name << ": insert " << (keys.size() / insertSec / 1e6) << ", lookup " << (queries.size() / lookupSec / 1e6)
+         << ", scan " << (scanned / scanSec / 1e6) << " keys, remove " << (keys.size() / 2 / removeSec / 1e6) << " Mops/s; height " << tree->computeHeight() << endl;
+    return checksum;
+}
+
+void experiment6(int numIntegers, int numLookups, int numRangeQueries, int rangeWidth) {
+    KeyWorkload range(UNIFORM_KEYS, 0, 4 * numIntegers);
+    vector<int> keys = generateKeys(numIntegers, 42, range);
+    vector<int> queries = generateKeys(numLookups, 43, range);
+    vector<int> rangeStarts = generateKeys(numRangeQueries, 44, range);
+
+    cout << "(EXP6.1) " << numIntegers << " random keys, " << numLookups << " lookups, " << numRangeQueries << " scans of width " << rangeWidth << endl;
+    AVLTree<int>* avl = new AVLTree<int>();
+    long long avlSum = orderedSetWorkload("AVLTree           ", avl, keys, queries, rangeStarts, rangeWidth);
+    delete avl;
+
+    BPlusTree<int>* bplus = new BPlusTree<int>();
+    long long bplusSum = orderedSetWorkload("BPlusTree<256 B>  ", bplus, keys, queries, rangeStarts, rangeWidth);
+    delete bplus;
+
+    BPlusTree<int, 4096>* bplusPage = new BPlusTree<int, 4096>();
+    long long bplusPageSum = orderedSetWorkload("BPlusTree<4096 B> ", bplusPage, keys, queries, rangeStarts, rangeWidth);
+    delete bplusPage;
+
+    cout << "(EXP6.2) B+tree fanout (256 B nodes): leaf " << BPlusTree<int>::leafFanout() << ", inner " << BPlusTree<int>::innerFanout() << endl;
+    cout << "         results agree with AVLTree? " << (avlSum == bplusSum && avlSum == bplusPageSum) << endl;
+}
+
+void experiment7(int numIntegers, int numLookups) {
+    KeyWorkload range(UNIFORM_KEYS, 0, 2 * numIntegers);
+    vector<int> keys = generateKeys(numIntegers, 7, range);
+    AVLTree<int>* avl = new AVLTree<int>();
+    for (int i = 0; i < numIntegers; i++)
+        avl->insert(keys[i]);
+    vector<int> queries = generateKeys(numLookups, 70, range);
+
+    auto start = chrono::high_resolution_clock::now();
+    EytzingerTree<int> frozen = avl->freeze();
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> freezeTime = end - start;
+
+    vector<int> sorted(avl->begin(), avl->end());
+    size_t n = sorted.size();
+    cout << "(EXP7.1) freeze() of " << n << " keys: " << freezeTime.count() << " ms" << endl;
+    cout << "         memory: AVLTree " << (n * AVLTree<int>::nodeBytes() / 1024) << " KiB, frozen " << (frozen.memoryBytes() / 1024) << " KiB" << endl;
+
+    long long hitsTree = 0, hitsFrozen = 0, hitsBatch = 0, hitsArray = 0;
+    start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numLookups; i++)
+        hitsTree += avl->contains(queries[i]);
+    end = chrono::high_resolution_clock::now();
+    double treeRate = numLookups / chrono::duration<double>(end - start).count();
+
+    start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numLookups; i++)
+        hitsFrozen += frozen.contains(queries[i]);
+    end = chrono::high_resolution_clock::now();
+    double frozenRate = numLookups / chrono::duration<double>(end - start).count();
+
+    vector<char> results;
+    start = chrono::high_resolution_clock::now();
+    frozen.containsBatch(queries, results);
+    end = chrono::high_resolution_clock::now();
+    double batchRate = numLookups / chrono::duration<double>(end - start).count();
+    for (size_t i = 0; i < results.size(); i++)
+        hitsBatch += results[i];
+
+    start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numLookups; i++)
+        hitsArray += binary_search(sorted.begin(), sorted.end(), queries[i]);
+    end = chrono::high_resolution_clock::now();
+    double arrayRate = numLookups / chrono::duration<double>(end - start).count();
+
+    cout << "(EXP7.2) " << numLookups << " lookups (Mlookups/s): AVLTree " << (treeRate / 1e6) << ", frozen " << (frozenRate / 1e6)
+         << ", frozen batched " << (batchRate / 1e6) << ", binary_search on sorted vector " << (arrayRate / 1e6) << endl;
+
+    bool boundsAgree = true;
+    for (int i = 0; i < numLookups && i < 10000; i++) {
+        const int* lb = frozen.lower_bound(queries[i]);
+        AVLTree<int>::const_iterator it = avl->lower_bound(queries[i]);
+        if ((lb == nullptr) != (it == avl->end()) || (lb != nullptr && *lb != *it))
+            boundsAgree = false;
+    }
+    cout << "         hit counts agree? " << (hitsTree == hitsFrozen && hitsFrozen == hitsBatch && hitsBatch == hitsArray)
+         << "; lower_bound agrees with AVLTree? " << boundsAgree << endl;
+
+    delete avl;
+}
+
+void experiment8(int numIntegers, int numLookups) {
+    KeyWorkload range(UNIFORM_KEYS, -1000000000, 1000000000);
+    vector<int> keys = generateKeys(numIntegers, 8, range);
+    AVLTree<int>* avl = new AVLTree<int>();
+    for (int i = 0; i < numIntegers; i++)
+        avl->insert(keys[i]);
+    vector<int> queries = generateKeys(numLookups, 80, range);
+    vector<int> sorted(avl->begin(), avl->end());
+
+    SimdSearchTree simd(*avl);
+    cout << "(EXP8.1) k-ary tree over " << simd.size() << " keys: " << (simd.memoryBytes() / 1024) << " KiB; best kernel on this CPU: "
+         << SimdSearchTree::kernelName(SimdSearchTree::bestKernel()) << endl;
+
+    long long expectedHits = 0, expectedRanks = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numLookups; i++)
+        expectedHits += avl->contains(queries[i]);
+    auto end = chrono::high_resolution_clock::now();
+    cout << "(EXP8.2) contains() queries/s: AVLTree " << (numLookups / chrono::duration<double>(end - start).count() / 1e6) << " M" << endl;
+    for (int i = 0; i < numLookups; i++)
+        expectedRanks += lower_bound(sorted.begin(), sorted.end(), queries[i]) - sorted.begin();
+
+    SimdSearchTree::Kernel kernels[] = { SimdSearchTree::SCALAR_KERNEL, SimdSearchTree::SSE2_KERNEL, SimdSearchTree::AVX2_KERNEL };
+    for (int k = 0; k < 3; k++) {
+        if (!SimdSearchTree::kernelSupported(kernels[k])) {
+            cout << "         " << SimdSearchTree::kernelName(kernels[k]) << ": not supported" << endl;
+            continue;
+        }
+        simd.setKernel(kernels[k]);
+        long long hits = 0, ranks = 0;
+        start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < numLookups; i++)
+            hits += simd.contains(queries[i]);
+        end = chrono::high_resolution_clock::now();
+        double containsRate = numLookups / chrono::duration<double>(end - start).count();
+        start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < numLookups; i++)
+            ranks += simd.rank(queries[i]);
+        end = chrono::high_resolution_clock::now();
+        double rankRate = numLookups / chrono::duration<double>(end - start).count();
+        cout << "         " << SimdSearchTree::kernelName(kernels[k]) << ": contains " << (containsRate / 1e6) << " M, rank " << (rankRate / 1e6)
+             << " M; matches AVLTree/lower_bound? " << (hits == expectedHits && ranks == expectedRanks) << endl;
+    }
+
+    delete avl;
+}
+
+// every thread runs a readPercent / (100 - readPercent) mix of contains and insert-or-remove
+// for durationMs; returns total operations per second
+template <typename Tree>
+static double mixedWorkload(Tree& tree, int numThreads, int readPercent, int keyRange, int durationMs) {
+    atomic<bool> stop(false);
+    atomic<long long> totalOps(0);
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.push_back(thread([&, t]() {
+            WorkloadRng rng = WorkloadRng::forIndex(100, t);   // one independent stream per worker
+            uniform_int_distribution<int> key(0, keyRange - 1);
+            uniform_int_distribution<int> percent(0, 99);
+            long long ops = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) {
+                    int x = key(rng);
+                    int p = percent(rng);
+                    if (p < readPercent)
+                        tree.contains(x);
+                    else if (p % 2 == 0)
+                        tree.insert(x);
+                    else
+                        tree.remove(x);
+                }
+                ops += 64;
+            }
+            totalOps += ops;
+        }));
+    }
+    auto start = chrono::high_resolution_clock::now();
+    this_thread::sleep_for(chrono::milliseconds(durationMs));
+    stop = true;
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    auto end = chrono::high_resolution_clock::now();
+    return totalOps.load() / chrono::duration<double>(end - start).count();
+}
+
+// the alternative to a concurrent tree: AVLTree behind one mutex
+struct LockedAVLTree {
+    AVLTree<int> tree;
+    mutex lock;
+    bool contains(int x) { lock_guard<mutex> g(lock); return tree.contains(x); }
+    void insert(int x) { lock_guard<mutex> g(lock); tree.insert(x); }
+    void remove(int x) { lock_guard<mutex> g(lock); tree.remove(x); }
+};
+
+void experiment9(int numIntegers, int maxThreads, int durationMs) {
+    int keyRange = 2 * numIntegers;
+    int readMixes[] = { 90, 50, 0 };
+    vector<int> threadCounts;
+    for (int t = 1; t <= maxThreads; t *= 2)
+        threadCounts.push_back(t);
+
+    cout << "(EXP9.1) " << numIntegers << " keys prefilled, " << durationMs << " ms per run, hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << "         Mops/s as concurrent OLC tree / AVLTree with a global mutex" << endl;
+    bool valid = true;
+    for (int m = 0; m < 3; m++) {
+        cout << "         " << readMixes[m] << "% reads:";
+        for (size_t i = 0; i < threadCounts.size(); i++) {
+            ConcurrentAVLTree<int>* concurrent = new ConcurrentAVLTree<int>();
+            LockedAVLTree* locked = new LockedAVLTree();
+            vector<int> keys = generateKeys(numIntegers, 9, KeyWorkload(UNIFORM_KEYS, 0, keyRange - 1));
+            for (int k = 0; k < numIntegers; k++) {
+                concurrent->insert(keys[k]);
+                locked->tree.insert(keys[k]);
+            }
+            double olc = mixedWorkload(*concurrent, threadCounts[i], readMixes[m], keyRange, durationMs);
+            double mutexed = mixedWorkload(*locked, threadCounts[i], readMixes[m], keyRange, durationMs);
+            valid = valid && concurrent->isBST() && concurrent->isBalanced();
+            cout << " " << threadCounts[i] << "T " << (olc / 1e6) << "/" << (mutexed / 1e6) << ";";
+            delete concurrent;
+            delete locked;
+        }
+        cout << endl;
+    }
+    cout << "(EXP9.2) concurrent tree ordered and AVL-balanced after every run? " << valid << endl;
+}
+
+void experiment10(int numIntegers, int numRangeQueries) {
+    KeyWorkload range(UNIFORM_KEYS, 0, 2 * numIntegers);
+    vector<int> keys = generateKeys(numIntegers, 10, range);
+    AVLTree<int>* plain = new AVLTree<int>();
+    AVLTree<int, SumAggregate<long long> >* summed = new AVLTree<int, SumAggregate<long long> >();
+    for (int i = 0; i < numIntegers; i++) {
+        plain->insert(keys[i]);
+        summed->insert(keys[i]);
+    }
+    cout << "(EXP10.1) node size: plain " << AVLTree<int>::nodeBytes() << " B, with a long long sum " << AVLTree<int, SumAggregate<long long> >::nodeBytes() << " B" << endl;
+
+    int widths[] = {10, 1000, 100000};
+    for (int w = 0; w < 3; w++) {
+        vector<int> starts = generateKeys(numRangeQueries, 100 + w, range);
+
+        long long walkSum = 0, aggSum = 0;
+        auto start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < numRangeQueries; i++)
+            plain->rangeVisit(starts[i], starts[i] + widths[w], [&](int x) { walkSum += x; });
+        auto end = chrono::high_resolution_clock::now();
+        double walkRate = numRangeQueries / chrono::duration<double>(end - start).count();
+
+        start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < numRangeQueries; i++)
+            aggSum += summed->rangeAggregate(starts[i], starts[i] + widths[w]);
+        end = chrono::high_resolution_clock::now();
+        double aggRate = numRangeQueries / chrono::duration<double>(end - start).count();
+
+        cout << "(EXP10.2) width " << widths[w] << ": rangeVisit " << (walkRate / 1e3) << " Kqueries/s, rangeAggregate "
+             << (aggRate / 1e3) << " Kqueries/s, sums agree? " << (walkSum == aggSum) << endl;
+    }
+    delete plain;
+    delete summed;
+}
+
+// one churn round inserts roundSize fresh keys and then deletes roundSize existing ones, like stage 2's
+// insert/delete pairs but batched so that each phase can be timed on its own
+template <typename Tree>
+static long long churnWorkload(const string& name, const vector<int>& initial, const vector<vector<int> >& roundInserts,
+                               const vector<vector<int> >& roundDeletes, const vector<int>& queries) {
+    Tree* tree = new Tree();
+    for (size_t i = 0; i < initial.size(); i++)
+        tree->insert(initial[i]);
+    tree->counters().reset();   // rotations per update below count the churn only, not the initial build
+
+    double insertSec = 0, deleteSec = 0;
+    long long inserted = 0, deleted = 0;
+    for (size_t r = 0; r < roundInserts.size(); r++) {
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < roundInserts[r].size(); i++)
+            tree->insert(roundInserts[r][i]);
+        auto mid = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < roundDeletes[r].size(); i++)
+            tree->remove(roundDeletes[r][i]);
+        auto end = chrono::high_resolution_clock::now();
+        insertSec += chrono::duration<double>(mid - start).count();
+        deleteSec += chrono::duration<double>(end - mid).count();
+        inserted += roundInserts[r].size();
+        deleted += roundDeletes[r].size();
+    }
+
+    long long hits = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < queries.size(); i++)
+        hits += tree->contains(queries[i]);
+    auto end = chrono::high_resolution_clock::now();
+    double lookupSec = chrono::duration<double>(end - start).count();
+
+    typename Tree::Stats s = tree->stats();
+    cout << "         " << name << ": insert " << (inserted / insertSec / 1e6) << ", delete " << (deleted / deleteSec / 1e6)
+         << ", lookup " << (queries.size() / lookupSec / 1e6) << " Mops/s; height " << s.height << ", average depth " << s.averageDepth << endl;
+    cout << "         " << name << "  rotations per insert " << (double)(s.inserts.singleRotations + s.inserts.doubleRotations) / s.inserts.calls
+         << ", per delete " << (double)(s.removes.singleRotations + s.removes.doubleRotations) / s.removes.calls
+         << " (" << s.removes.doubleRotations << " double); valid? " << tree->validate() << endl;
+    delete tree;
+    return hits;
+}
+
+void experiment11(int numIntegers, int numChurnRounds, int roundSize, int numLookups) {
+    WorkloadRng rng(11);
+    uniform_int_distribution<int> dist(-1000000000, 1000000000);
+
+    // draw the whole churn sequence up front so that every policy replays exactly the same operations
+    vector<int> present;
+    unordered_set<int> seen;
+    while ((int)present.size() < numIntegers) {
+        int x = dist(rng);
+        if (seen.insert(x).second)
+            present.push_back(x);
+    }
+    vector<int> initial = present;
+    vector<vector<int> > roundInserts(numChurnRounds), roundDeletes(numChurnRounds);
+    for (int r = 0; r < numChurnRounds; r++) {
+        for (int i = 0; i < roundSize; i++) {
+            int x = dist(rng);
+            while (!seen.insert(x).second)
+                x = dist(rng);
+            present.push_back(x);
+            roundInserts[r].push_back(x);
+        }
+        for (int i = 0; i < roundSize; i++) {
+            size_t victim = uniform_int_distribution<size_t>(0, present.size() - 1)(rng);
+            roundDeletes[r].push_back(present[victim]);
+            seen.erase(present[victim]);
+            present[victim] = present.back();
+            present.pop_back();
+        }
+    }
+    vector<int> queries;
+    for (int i = 0; i < numLookups; i++)
+        queries.push_back((i % 2 == 0) ? present[rng.below(present.size())] : dist(rng));
+
+    cout << "(EXP11.1) " << numIntegers << " keys, " << numChurnRounds << " rounds of " << roundSize << " inserts + " << roundSize << " deletes, then "
+         << numLookups << " lookups" << endl;
+    // rotation counting only, so the throughput numbers stay comparable across the three policies
+    long long hitsAVL = churnWorkload<AVLTree<int, NoAggregate, RotationInstrumentation> >("AVL      ", initial, roundInserts, roundDeletes, queries);
+    long long hitsWAVL = churnWorkload<AVLTree<int, NoAggregate, RotationInstrumentation, WAVLBalance> >("WAVL     ", initial, roundInserts, roundDeletes, queries);
+    long long hitsRB = churnWorkload<AVLTree<int, NoAggregate, RotationInstrumentation, RedBlackBalance> >("red-black", initial, roundInserts, roundDeletes, queries);
+    cout << "(EXP11.2) lookup results agree? " << (hitsAVL == hitsWAVL && hitsWAVL == hitsRB) << endl;
+}
+
+// order-sensitive fingerprint of the in-order sequence, so reloaded trees can be compared without keeping two around
+static unsigned long long sequenceFingerprint(const AVLTree<int>* avl) {
+    unsigned long long h = 0;
+    for (AVLTree<int>::const_iterator it = avl->begin(); it != avl->end(); ++it)
+        h = h * 1000003 + (unsigned int)*it;
+    return h;
+}
+
+void experiment12(int numIntegers, const string& path) {
+    vector<int> keys = generateKeys(numIntegers, 12, KeyWorkload(UNIFORM_KEYS, 0, 4 * numIntegers));
+    AVLTree<int>* avl = new AVLTree<int>();
+
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numIntegers; i++)
+        avl->insert(keys[i]);
+    auto end = chrono::high_resolution_clock::now();
+    double insertMs = chrono::duration<double, milli>(end - start).count();
+    int n = avl->treeSize();
+    unsigned long long fingerprint = sequenceFingerprint(avl);
+
+    start = chrono::high_resolution_clock::now();
+    avl->save(path);
+    end = chrono::high_resolution_clock::now();
+    double saveMs = chrono::duration<double, milli>(end - start).count();
+    delete avl;
+
+    ifstream sizeProbe(path.c_str(), ios::binary | ios::ate);
+    double fileBytes = (double)sizeProbe.tellg();
+    cout << "(EXP12.1) " << n << " keys built by insert() in " << insertMs << " ms; save() " << saveMs << " ms" << endl;
+    cout << "          file " << (fileBytes / (1 << 20)) << " MiB = " << (fileBytes / n) << " B/key (raw int array: " << sizeof(int) << " B/key)" << endl;
+
+    avl = new AVLTree<int>();
+    start = chrono::high_resolution_clock::now();
+    avl->load(path);
+    end = chrono::high_resolution_clock::now();
+    double loadMs = chrono::duration<double, milli>(end - start).count();
+    bool loadOk = avl->validate() && avl->treeSize() == n && sequenceFingerprint(avl) == fingerprint;
+    int loadHeight = avl->readRootHeight();
+    delete avl;
+
+    avl = new AVLTree<int>();
+    start = chrono::high_resolution_clock::now();
+    avl->loadMapped(path);
+    end = chrono::high_resolution_clock::now();
+    double mappedMs = chrono::duration<double, milli>(end - start).count();
+    bool mappedOk = avl->validate() && avl->treeSize() == n && sequenceFingerprint(avl) == fingerprint;
+    delete avl;
+
+    cout << "(EXP12.2) load() " << loadMs << " ms, loadMapped() " << mappedMs << " ms (vs " << insertMs << " ms of inserts); reloaded height "
+         << loadHeight << " (log2(n)=" << cLog2(n) << ")" << endl;
+    cout << "          reloaded trees valid and identical? stream " << loadOk << ", mmap " << mappedOk << endl;
+    remove(path.c_str());
+}
+
+// distinct pseudo-random keys without a hash set: multiplying by an odd constant is a bijection on 32 bits,
+// so benchKey(2i) are the keys in the tree and benchKey(2i + 1) are guaranteed misses
+static int benchKey(long long i, unsigned seed) {
+    return (int)(((unsigned int)i * 2654435761u) ^ seed);
+}
+
+struct BenchmarkRow
+{
+    long long size;
+    string operation;
+    long long opsPerRep;
+    vector<double> batchNs;     // ns/op of every timed batch, over all repetitions
+};
+
+// times ops[first, first + count) of whatever run(i) does, one sample per batch
+template <typename Op>
+static void timeBatches(long long count, vector<double>* samples, Op run) {
+    for (long long first = 0; first < count; first += BENCH_BATCH) {
+        long long last = min(count, first + (long long)BENCH_BATCH);
+        auto start = chrono::steady_clock::now();
+        for (long long i = first; i < last; i++)
+            run(i);
+        auto end = chrono::steady_clock::now();
+        if (samples != nullptr)
+            samples->push_back(chrono::duration<double, nano>(end - start).count() / (last - first));
+    }
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t k = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[k];
+}
+
+// one repetition at one size: build, lookups, stage 2 style churn, teardown; samples == nullptr for warmups
+static void benchmarkRepetition(long long n, long long numOps, unsigned seed, int rep, vector<BenchmarkRow>& rows, bool timed) {
+    WorkloadRng rng = WorkloadRng::forIndex(seed, rep);
+    vector<int> keys(n);
+    for (long long i = 0; i < n; i++)
+        keys[i] = benchKey(2 * i, seed);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    vector<int> hits(numOps), misses(numOps), churnInserts(numOps), churnRemoves(numOps);
+    uniform_int_distribution<long long> pick(0, n - 1);
+    for (long long i = 0; i < numOps; i++) {
+        hits[i] = keys[pick(rng)];
+        misses[i] = benchKey(2 * pick(rng) + 1, seed);
+    }
+    // churn: insert a fresh key, then remove a random present one; planned here so the timed loop only touches the tree
+    vector<int> present = keys;
+    for (long long i = 0; i < numOps; i++) {
+        churnInserts[i] = benchKey(2 * (n + i), seed);
+        present.push_back(churnInserts[i]);
+        size_t victim = uniform_int_distribution<size_t>(0, present.size() - 1)(rng);
+        churnRemoves[i] = present[victim];
+        present[victim] = present.back();
+        present.pop_back();
+    }
+
+    AVLTree<int>* avl = new AVLTree<int>();
+    volatile long long sink = 0;
+    timeBatches(n, timed ? &rows[0].batchNs : nullptr, [&](long long i) { avl->insert(keys[i]); });
+    timeBatches(numOps, timed ? &rows[1].batchNs : nullptr, [&](long long i) { sink += avl->contains(hits[i]); });
+    timeBatches(numOps, timed ? &rows[2].batchNs : nullptr, [&](long long i) { sink += avl->contains(misses[i]); });
+    timeBatches(numOps, timed ? &rows[3].batchNs : nullptr, [&](long long i) { avl->insert(churnInserts[i]); avl->remove(churnRemoves[i]); });
+    timeBatches((long long)present.size(), timed ? &rows[4].batchNs : nullptr, [&](long long i) { avl->remove(present[i]); });
+    delete avl;
+}
+
+void runBenchmarks(const BenchmarkConfig& config) {
+    vector<BenchmarkRow> all;
+    for (size_t s = 0; s < config.sizes.size(); s++) {
+        long long n = config.sizes[s];
+        long long numOps = (config.numOps > 0) ? config.numOps : n;
+        const char* names[] = {"insert", "lookup_hit", "lookup_miss", "churn_insert_remove", "remove"};
+        long long counts[] = {n, numOps, numOps, numOps, n};
+        vector<BenchmarkRow> rows(5);
+        for (int k = 0; k < 5; k++) {
+            rows[k].size = n;
+            rows[k].operation = names[k];
+            rows[k].opsPerRep = counts[k];
+        }
+        for (int w = 0; w < config.warmups; w++)
+            benchmarkRepetition(n, numOps, config.seed, -1 - w, rows, false);
+        for (int r = 0; r < config.repetitions; r++)
+            benchmarkRepetition(n, numOps, config.seed, r, rows, true);
+        all.insert(all.end(), rows.begin(), rows.end());
+    }
+
+    ofstream file;
+    if (!config.outputPath.empty())
+        file.open(config.outputPath.c_str());
+    ostream& out = config.outputPath.empty() ? cout : file;
+    bool json = (config.format == "json");
+    if (json)
+        out << "[" << endl;
+    else
+        out << "size,operation,repetitions,ops_per_rep,mean_ns,p50_ns,p90_ns,p99_ns,min_ns,max_ns" << endl;
+    for (size_t i = 0; i < all.size(); i++) {
+        vector<double> sorted = all[i].batchNs;
+        sort(sorted.begin(), sorted.end());
+        double mean = 0;
+        for (size_t j = 0; j < sorted.size(); j++)
+            mean += sorted[j];
+        mean = sorted.empty() ? 0 : mean / sorted.size();
+        double lo = sorted.empty() ? 0 : sorted.front();
+        double hi = sorted.empty() ? 0 : sorted.back();
+        if (json) {
+            out << "  {\"size\": " << all[i].size << ", \"operation\": \"" << all[i].operation << "\", \"repetitions\": " << config.repetitions
+                << ", \"ops_per_rep\": " << all[i].opsPerRep << ", \"mean_ns\": " << mean << ", \"p50_ns\": " << percentile(sorted, 0.50)
+                << ", \"p90_ns\": " << percentile(sorted, 0.90) << ", \"p99_ns\": " << percentile(sorted, 0.99)
+                << ", \"min_ns\": " << lo << ", \"max_ns\": " << hi << "}" << (i + 1 < all.size() ? "," : "") << endl;
+        } else {
+            out << all[i].size << "," << all[i].operation << "," << config.repetitions << "," << all[i].opsPerRep << "," << mean << ","
+                << percentile(sorted, 0.50) << "," << percentile(sorted, 0.90) << "," << percentile(sorted, 0.99) << "," << lo << "," << hi << endl;
+        }
+    }
+    if (json)
+        out << "]" << endl;
 }
\ No newline at end of file
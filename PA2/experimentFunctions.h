@@ -10,8 +10,13 @@
 #include <ctime>   // For time()
 #include <chrono>
 #include <cmath>
+#include <string>
 
 
+// experiment 2 runs on a tree that counts comparisons and rebalancing work;
+// use NoInstrumentation here to time the same code without the counters
+typedef AVLTree<int, NoAggregate, CountingInstrumentation> Experiment2Tree;
+
 // util function for log2
 double cLog2(double d);
 
@@ -21,16 +26,65 @@ bool testBalanced(AVLTree<int>* avl);
 bool testContains(AVLTree<int>*avl, int numData);
 
 // test functions for experiment 2
-bool testSize(AVLTree<int> * avl, int targetNumIntegers);
-bool testHeight(AVLTree<int>* avl);
+bool testBalanced(Experiment2Tree* avl);
+bool testSize(Experiment2Tree * avl, int targetNumIntegers);
+bool testHeight(Experiment2Tree* avl);
 
 // random insert/remove for experiment 2
-void insertRandomIntegers(AVLTree<int>* avl, int numIntegers);
-void deleteRandomIntegers(AVLTree<int>* avl, int numDelete);
+void insertRandomIntegers(Experiment2Tree* avl, int numIntegers);
+void deleteRandomIntegers(Experiment2Tree* avl, int numDelete);
+void printOperationCounters(const char* label, const OperationCounters& counters);
 
 // directly perform experiments
 void experiment1(int numIntegers);
-void stage1(AVLTree<int>* avl, int numIntegers);
-void stage2(AVLTree<int>* avl, int numRandomInsertRemove);
+void stage1(Experiment2Tree* avl, int numIntegers);
+void stage2(Experiment2Tree* avl, int numRandomInsertRemove);
+
+// experiment 3: in-order iteration and range queries
+bool testIterators(AVLTree<int>* avl, const vector<int>& sorted);
+void experiment3(int numIntegers, int numRangeQueries, int rangeWidth);
+
+// experiment 4: join/split based parallel set operations
+void experiment4(int numIntegers);
+
+// experiment 5: persistent AVL tree snapshots under a concurrent writer
+void experiment5(int numIntegers, int numSnapshots, int numReaders);
+
+// experiment 6: B+tree vs AVL tree throughput
+void experiment6(int numIntegers, int numLookups, int numRangeQueries, int rangeWidth);
+
+// experiment 7: frozen Eytzinger snapshot vs the live tree
+void experiment7(int numIntegers, int numLookups);
+
+// experiment 8: SIMD k-ary search tree built from AVLTree<int>
+void experiment8(int numIntegers, int numLookups);
+
+// experiment 9: multi-threaded throughput of the optimistic lock coupling AVL tree
+void experiment9(int numIntegers, int maxThreads, int durationMs);
+
+// experiment 10: range sums from subtree aggregates vs walking the range
+void experiment10(int numIntegers, int numRangeQueries);
+
+// experiment 11: AVL, WAVL and red-black balancing under stage 2 style insert/delete churn
+void experiment11(int numIntegers, int numChurnRounds, int roundSize, int numLookups);
+
+// experiment 12: checkpoint to disk and reload by linear-time construction, via stream and mmap
+void experiment12(int numIntegers, const string& path);
+
+// benchmark driver ("PA2 bench ..."): ns/op of AVLTree<int> operations over a range of tree sizes.
+// Every phase is timed in batches of BENCH_BATCH operations and the percentiles are over those batches;
+// nothing is printed until all measurements are done.
+struct BenchmarkConfig
+{
+    vector<long long> sizes;    // number of keys in the tree
+    long long numOps;           // lookups / churn pairs per repetition, 0 = as many as keys
+    int repetitions;
+    int warmups;                // untimed repetitions run first
+    unsigned seed;
+    string format;              // "csv" or "json"
+    string outputPath;          // empty = stdout
+};
+const int BENCH_BATCH = 1000;
+void runBenchmarks(const BenchmarkConfig& config);
 
 #endif 
\ No newline at end of file
@@ -4,8 +4,76 @@
 using namespace std;
 
 
-int main()
+static void usage() {
+    cerr << "usage: PA2                  run experiments 1-12" << endl;
+    cerr << "       PA2 bench [--sizes 1000,10000,...] [--ops N] [--reps R] [--warmup W] [--seed S]" << endl;
+    cerr << "                 [--format csv|json] [--output FILE]" << endl;
+}
+
+// "1000,1e6,100000000" -> sizes; 1eK is accepted as shorthand for 10^K
+static vector<long long> parseSizes(const string& list) {
+    vector<long long> sizes;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        string item = list.substr(pos, (comma == string::npos) ? string::npos : comma - pos);
+        if (!item.empty())
+            sizes.push_back((long long)atof(item.c_str()));
+        if (comma == string::npos)
+            break;
+        pos = comma + 1;
+    }
+    return sizes;
+}
+
+static int runBenchMode(int argc, char *argv[]) {
+    BenchmarkConfig config;
+    config.sizes = parseSizes("1e3,1e4,1e5,1e6");
+    config.numOps = 0;
+    config.repetitions = 5;
+    config.warmups = 1;
+    config.seed = 42;
+    config.format = "csv";
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--sizes")
+            config.sizes = parseSizes(value);
+        else if (arg == "--ops")
+            config.numOps = (long long)atof(value.c_str());
+        else if (arg == "--reps")
+            config.repetitions = atoi(value.c_str());
+        else if (arg == "--warmup")
+            config.warmups = atoi(value.c_str());
+        else if (arg == "--seed")
+            config.seed = (unsigned)strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--format" && (value == "csv" || value == "json"))
+            config.format = value;
+        else if (arg == "--output")
+            config.outputPath = value;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    runBenchmarks(config);
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
+    if (argc > 1) {
+        if (string(argv[1]) == "bench")
+            return runBenchMode(argc, argv);
+        usage();
+        return 1;
+    }
+
     // experiment 1: test BST order and AVL height condition
     cout << "================================ Experiment 1 ================================" << endl;
     int numIntegers = 20;
@@ -17,7 +85,7 @@ int main()
 
     // Stage 1: insert random integers into AVL BST, as Figure 4.29 of textbook
     numIntegers = 20;
-    AVLTree<int>*avl = new AVLTree<int>();
+    Experiment2Tree*avl = new Experiment2Tree();
     stage1(avl, numIntegers);
     cout << endl;
 
@@ -28,6 +96,56 @@ int main()
 
     // delete this avl
     delete avl;
+    cout << endl;
+
+    // experiment 3: in-order iterators and range queries against a sorted array
+    cout << "=========================== Experiment 3, Range Scans ===========================" << endl;
+    experiment3(100000, 1000, 100);
+    cout << endl;
+
+    // experiment 4: union/intersection/difference built on join and split
+    cout << "========================= Experiment 4, Set Operations =========================" << endl;
+    experiment4(200000);
+    cout << endl;
+
+    // experiment 5: O(1) snapshots of a path-copying AVL tree for concurrent readers
+    cout << "======================= Experiment 5, Persistent Snapshots =======================" << endl;
+    experiment5(200000, 1000000, 4);
+    cout << endl;
+
+    // experiment 6: cache-friendly B+tree against the AVL tree on the same workload
+    cout << "========================= Experiment 6, B+tree vs AVL =========================" << endl;
+    experiment6(500000, 1000000, 10000, 1000);
+    cout << endl;
+
+    // experiment 7: read-only Eytzinger layout produced by AVLTree::freeze()
+    cout << "======================= Experiment 7, Frozen Eytzinger Layout =======================" << endl;
+    experiment7(1000000, 2000000);
+    cout << endl;
+
+    // experiment 8: cache-line k-ary search with scalar/SSE2/AVX2 node compares
+    cout << "======================== Experiment 8, SIMD k-ary Search ========================" << endl;
+    experiment8(1000000, 2000000);
+    cout << endl;
+
+    // experiment 9: 90/10, 50/50 and write-only mixes on the concurrent AVL tree, 1 to 32 threads
+    cout << "====================== Experiment 9, Concurrent AVL Scaling ======================" << endl;
+    experiment9(100000, 32, 200);
+    cout << endl;
+
+    // experiment 10: O(log n) range sums from per-node aggregates against an O(log n + k) walk
+    cout << "====================== Experiment 10, Range Aggregates ======================" << endl;
+    experiment10(1000000, 1000);
+    cout << endl;
+
+    // experiment 11: which balancing policy suits a delete-heavy churn, as in experiment 2 stage 2
+    cout << "==================== Experiment 11, AVL vs WAVL vs Red-Black ====================" << endl;
+    experiment11(1000000, 50, 10000, 2000000);
+    cout << endl;
+
+    // experiment 12: binary checkpoint and O(n) reload; pass 100000000 for the 100M-key run (about 5 GB of tree nodes)
+    cout << "==================== Experiment 12, Save and Reload ====================" << endl;
+    experiment12(5000000, "PA2_checkpoint.bin");
 
     return 0;
 
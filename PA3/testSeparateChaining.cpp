@@ -5,15 +5,9 @@ using namespace std;
 
 vector<Employee> addRandomEntries(int numEntries, ChainingHash<Employee> & aHashTable)
 {
-    vector<string> names = generateRandomNames(numEntries);
-    vector<int> salaries = generateRandomIntegers(numEntries);
-    vector<Employee> employeeVector;
-    for (int i = 0; i < numEntries; i++)
-    {
-        Employee emp(names[i], double( salaries[i]) );
+    vector<Employee> employeeVector = generateRandomEmployees(numEntries);
+    for (const Employee & emp : employeeVector)
         aHashTable.insert( emp );
-        employeeVector.push_back( emp );
-    }
     return employeeVector;
 }
 
@@ -34,43 +34,42 @@ int nextPrime( int n )
     return n;
 }
 
+static uint64_t workloadSeed = 223;
+static WorkloadRng workloadRng(workloadSeed);
+
+void setWorkloadSeed(uint64_t seed) {
+    workloadSeed = seed;
+    workloadRng = WorkloadRng(seed);
+}
+
+static uint64_t nextWorkloadSeed() {
+    return workloadSeed++;
+}
+
 string generateARandomName(int length) {
-    static const std::string allowedChars =
-        "abcdefghijklmnopqrstuvwxyz"
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-
-    random_device rd;
-    mt19937 generator(rd()); 
-    uniform_int_distribution<int> distribution(0, allowedChars.size() - 1);
-
-    string name;
-    for (int i = 0; i < length; ++i) {
-        name += allowedChars[distribution(generator)];
-    }
-    return name;
+    return randomName(workloadRng, length);
 }
 
 vector<string> generateRandomNames(int numNames) {
     int stringLength = 10;
-    vector<string> strings;
-    for (int i = 0; i < numNames; i++)
-        strings.push_back( generateARandomName(stringLength) );
-    return strings;
+    return generateNames(numNames, stringLength, nextWorkloadSeed());
 }
 
 
 int generateARandomInteger(int MAXNUM) {
-    random_device dev;
-    mt19937 rng(dev());
-    uniform_int_distribution<std::mt19937::result_type> dist6(1, MAXNUM); 
-
-    return dist6(rng);
+    return (int)workloadRng.between(1, MAXNUM);
 }
 
 vector<int> generateRandomIntegers(int numNumbers) {
     int MAXNUM = 100000000;
-    vector<int> numbers;
-    for (int i=0; i < numNumbers; i++)
-        numbers.push_back( generateARandomInteger(MAXNUM) );
-    return numbers;
+    return generateKeys(numNumbers, nextWorkloadSeed(), KeyWorkload(UNIFORM_KEYS, 1, MAXNUM));
+}
+
+vector<Employee> generateRandomEmployees(int numEmployees) {
+    int stringLength = 10;
+    int MAXSALARY = 100000000;
+    return generateRecords<Employee>(numEmployees, nextWorkloadSeed(), [=](WorkloadRng & rng, size_t) {
+        string name = randomName(rng, stringLength);
+        return Employee(name, double( rng.between(1, MAXSALARY) ));
+    });
 }
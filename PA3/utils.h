@@ -4,6 +4,7 @@
 #include <random>
 #include <string>
 #include "Employee.h"
+#include "../common/Workload.h"
 
 using namespace std;
 
@@ -14,9 +15,13 @@ extern Employee emp4;
 
 bool isPrime( int n );
 int nextPrime( int n );
+// random test data comes from common/Workload.h; each generate* call takes the next seed of a fixed
+// sequence, so a run is repeatable and separate calls are still independent
+void setWorkloadSeed(uint64_t seed);
 string generateARandomName(int length);
 vector<string> generateRandomNames(int numNames);
 int generateARandomInteger(int MAXNUM);
 vector<int> generateRandomIntegers(int numNumbers);
+vector<Employee> generateRandomEmployees(int numEmployees);
 
 #endif
\ No newline at end of file
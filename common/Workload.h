@@ -0,0 +1,266 @@
+#ifndef Workload_H
+#define Workload_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <climits>
+#include <stdexcept>
+
+using namespace std;
+
+// Reproducible test data for the experiments in PA2, PA3 and MA3.
+//
+// Element i of every fill is a pure function of (seed, i): counterHash() mixes the two into 64 random
+// bits, and WorkloadRng::forIndex() seeds a small xoshiro256** generator from them when one element
+// needs several draws. A fill therefore has no shared generator state, so it splits across OpenMP
+// threads (when the including project builds with -fopenmp) and gives the same output for any number
+// of threads. The uniform key fill is branch-free per element and is compiled as an omp simd loop.
+//
+//     vector<int> keys = generateKeys(1000000, 42);                                   // uniform in [1, INT_MAX]
+//     vector<int> hot  = generateKeys(1000000, 42, KeyWorkload(ZIPFIAN_KEYS, 1, 1000));
+//     vector<string> names = generateNames(1000, 10, 7);
+//     vector<Employee> staff = generateRecords<Employee>(1000, 7, makeEmployee);      // make(rng, i)
+
+// splitmix64 finalizer (Steele, Lea and Flood): a bijection on 64 bits with full avalanche
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// 64 random bits for element `index` of the stream `seed`
+inline uint64_t counterHash(uint64_t seed, uint64_t index) {
+    return mix64(mix64(seed) + (index + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+// maps 64 random bits to [0, bound) with one multiply (Lemire); the bias is below bound / 2^64
+inline uint64_t scaleBelow(uint64_t bits, uint64_t bound) {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(bits) * bound) >> 64);
+}
+
+// xoshiro256** (Blackman and Vigna). Satisfies UniformRandomBitGenerator, so it also works with the
+// <random> distributions, and is several times faster than mt19937 with 32 bytes of state.
+class WorkloadRng
+{
+public:
+    typedef uint64_t result_type;
+
+    explicit WorkloadRng(uint64_t seed = 0) {
+        uint64_t x = seed;
+        for (int i = 0; i < 4; i++) {
+            x += 0x9e3779b97f4a7c15ULL;
+            s[i] = mix64(x);
+        }
+    }
+
+    // an independent generator for element `index` of the stream `seed`
+    static WorkloadRng forIndex(uint64_t seed, uint64_t index) { return WorkloadRng(counterHash(seed, index)); }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    uint64_t below(uint64_t bound) { return scaleBelow((*this)(), bound); }
+    long long between(long long lo, long long hi) { return lo + static_cast<long long>(below(static_cast<uint64_t>(hi - lo) + 1)); }
+    double real() { return ((*this)() >> 11) * (1.0 / 9007199254740992.0); }   // [0, 1)
+
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// Zipf distribution over ranks 1..n, P(k) proportional to 1 / k^skew, by rejection-inversion
+// (Hoermann and Derflinger, 1996): O(1) time and space per sample for any n, no table of n weights
+class ZipfSampler
+{
+public:
+    ZipfSampler(long long n, double skew) : numRanks(n), s(skew) {
+        if (n < 1 || skew <= 0) {
+            throw invalid_argument("ZipfSampler: need n >= 1 and skew > 0");
+        }
+        hIntegralX1 = hIntegral(1.5) - 1.0;
+        hIntegralN = hIntegral(n + 0.5);
+        threshold = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    long long operator()(WorkloadRng & rng) const {
+        while (true) {
+            double u = hIntegralN + rng.real() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            long long k = static_cast<long long>(x + 0.5);
+            if (k < 1) {
+                k = 1;
+            } else if (k > numRanks) {
+                k = numRanks;
+            }
+            if (k - x <= threshold || u >= hIntegral(k + 0.5) - h(static_cast<double>(k))) {
+                return k;
+            }
+        }
+    }
+
+private:
+    long long numRanks;
+    double s;
+    double hIntegralX1;
+    double hIntegralN;
+    double threshold;
+
+    double h(double x) const { return exp(-s * log(x)); }
+    double hIntegral(double x) const {
+        double logX = log(x);
+        return expm1OverX((1.0 - s) * logX) * logX;
+    }
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - s);
+        if (t < -1.0) {
+            t = -1.0;
+        }
+        return exp(log1pOverX(t) * x);
+    }
+    // log1p(x) / x and expm1(x) / x, continuous at 0
+    static double log1pOverX(double x) { return (fabs(x) > 1e-8) ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x)); }
+    static double expm1OverX(double x) { return (fabs(x) > 1e-8) ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x)); }
+};
+
+//   UNIFORM_KEYS         independent, uniform in [minKey, maxKey]; duplicates possible
+//   ZIPFIAN_KEYS         minKey + rank - 1 with rank ~ Zipf(zipfSkew) over the range; minKey is the hottest
+//   SORTED_KEYS          n distinct keys spread evenly over the range, ascending (worst case for a plain BST)
+//   REVERSE_SORTED_KEYS  the same keys, descending
+//   ZIGZAG_KEYS          the same keys alternately from the low and the high end, so every insert is at an extreme
+//   STRIDED_KEYS         uniform multiples of `stride` above minKey; they share one residue class, so a hash
+//                        table whose size is a multiple of the stride puts them all in a fraction of its buckets
+enum KeyDistribution { UNIFORM_KEYS, ZIPFIAN_KEYS, SORTED_KEYS, REVERSE_SORTED_KEYS, ZIGZAG_KEYS, STRIDED_KEYS };
+
+struct KeyWorkload
+{
+    KeyDistribution distribution;
+    int minKey;
+    int maxKey;
+    double zipfSkew;
+    int stride;
+
+    KeyWorkload(KeyDistribution d = UNIFORM_KEYS, int lo = 1, int hi = INT_MAX)
+        : distribution(d), minKey(lo), maxKey(hi), zipfSkew(0.99), stride(1024) {}
+};
+
+// key i of an n-key SORTED_KEYS workload
+inline int evenlySpacedKey(const KeyWorkload & w, size_t n, size_t i) {
+    uint64_t range = static_cast<uint64_t>(static_cast<long long>(w.maxKey) - w.minKey) + 1;
+    uint64_t step = (n < range) ? range / n : 1;
+    return static_cast<int>(w.minKey + static_cast<long long>((i * step) % range));
+}
+
+inline void fillKeys(int * out, size_t n, uint64_t seed, const KeyWorkload & w) {
+    if (w.maxKey < w.minKey) {
+        throw invalid_argument("fillKeys: maxKey < minKey");
+    }
+    long long count = static_cast<long long>(n);
+    uint64_t range = static_cast<uint64_t>(static_cast<long long>(w.maxKey) - w.minKey) + 1;
+    long long lo = w.minKey;
+
+    if (w.distribution == UNIFORM_KEYS) {
+        #ifdef _OPENMP
+        #pragma omp parallel for simd schedule(static)
+        #endif
+        for (long long i = 0; i < count; i++) {
+            out[i] = static_cast<int>(lo + static_cast<long long>(scaleBelow(counterHash(seed, i), range)));
+        }
+    } else if (w.distribution == ZIPFIAN_KEYS) {
+        ZipfSampler zipf(static_cast<long long>(range), w.zipfSkew);
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+        #endif
+        for (long long i = 0; i < count; i++) {
+            WorkloadRng rng = WorkloadRng::forIndex(seed, i);
+            out[i] = static_cast<int>(lo + zipf(rng) - 1);
+        }
+    } else if (w.distribution == STRIDED_KEYS) {
+        if (w.stride < 1) {
+            throw invalid_argument("fillKeys: stride must be positive");
+        }
+        uint64_t slots = (range - 1) / w.stride + 1;
+        #ifdef _OPENMP
+        #pragma omp parallel for simd schedule(static)
+        #endif
+        for (long long i = 0; i < count; i++) {
+            out[i] = static_cast<int>(lo + static_cast<long long>(scaleBelow(counterHash(seed, i), slots)) * w.stride);
+        }
+    } else {
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+        #endif
+        for (long long i = 0; i < count; i++) {
+            size_t j = static_cast<size_t>(i);
+            if (w.distribution == REVERSE_SORTED_KEYS) {
+                j = n - 1 - j;
+            } else if (w.distribution == ZIGZAG_KEYS) {
+                j = (j % 2 == 0) ? j / 2 : n - 1 - j / 2;
+            }
+            out[i] = evenlySpacedKey(w, n, j);
+        }
+    }
+}
+
+inline vector<int> generateKeys(size_t n, uint64_t seed, const KeyWorkload & w = KeyWorkload()) {
+    vector<int> keys(n);
+    if (n > 0) {
+        fillKeys(&keys[0], n, seed, w);
+    }
+    return keys;
+}
+
+// records built by make(WorkloadRng & rng, size_t i), one independent generator per element; T must be
+// default constructible and make must not touch shared state
+template <typename T, typename Make>
+vector<T> generateRecords(size_t n, uint64_t seed, Make make) {
+    vector<T> records(n);
+    long long count = static_cast<long long>(n);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (long long i = 0; i < count; i++) {
+        WorkloadRng rng = WorkloadRng::forIndex(seed, i);
+        records[i] = make(rng, static_cast<size_t>(i));
+    }
+    return records;
+}
+
+const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const char LOWERCASE_LETTERS[] = "abcdefghijklmnopqrstuvwxyz";
+
+// `length` characters drawn uniformly from alphabet[0, alphabetSize); two characters per 64-bit draw
+inline string randomString(WorkloadRng & rng, int length, const char * alphabet, size_t alphabetSize) {
+    string s(length, ' ');
+    for (int i = 0; i < length; i += 2) {
+        uint64_t bits = rng();
+        s[i] = alphabet[((bits & 0xffffffffULL) * alphabetSize) >> 32];
+        if (i + 1 < length) {
+            s[i + 1] = alphabet[((bits >> 32) * alphabetSize) >> 32];
+        }
+    }
+    return s;
+}
+
+inline string randomName(WorkloadRng & rng, int length) { return randomString(rng, length, LETTERS, sizeof(LETTERS) - 1); }
+
+inline vector<string> generateNames(size_t n, int length, uint64_t seed) {
+    return generateRecords<string>(n, seed, [length](WorkloadRng & rng, size_t) { return randomName(rng, length); });
+}
+
+#endif